@@ -0,0 +1,252 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define BENCH_FILE "benchbuffer.bin"
+
+// number of distinct pages touched by each run, every pin is a miss
+#define NUM_MISSES 8192
+
+// uniform-random pins per thread of the throughput runs, which use a pool of a quarter
+// of the pages
+#define NUM_PINS 200000
+#define THROUGHPUT_FRAMES (NUM_MISSES / 4)
+
+// full scans per layout of the victim search benchmark
+#define NUM_SCANS 64
+
+static BM_BufferPool throughputPool;
+
+// a frame record with the fields of BM_PageFrame before the fix counts moved into an array
+// of their own
+typedef struct AoSFrame {
+    char *data;
+    PageNumber pageNum;
+    int frameIndex;
+    int fixCount;
+    bool dirty;
+    bool occupied;
+    bool referenced;
+    int frequency;
+    int arcList;
+    bool linked;
+    int prev;
+    int next;
+    int heapPos;
+    bool arcForget;
+    int state;
+    pthread_mutex_t latch;
+} AoSFrame;
+
+// the victim search kernels of buffer_mgr.c
+int findUnpinned(const int *fixCounts, int from, int to);
+int findUnpinnedScalar(const int *fixCounts, int from, int to);
+
+static double nowNs(void);
+static const char *stratName(ReplacementStrategy strategy);
+static void benchMissLatency(int numFrames, ReplacementStrategy strategy);
+static void *pinRandomPages(void *arg);
+static void benchThroughput(int numThreads, int numPartitions);
+static void benchStartup(int numFrames, HugePages hugePages);
+static void benchScan(int numFrames);
+
+// main method
+// usage: ./bench_buffer_mgr.o [maxFrames]
+int
+main (int argc, char **argv)
+{
+    int maxFrames = (argc > 1) ? atoi(argv[1]) : (1 << 20);
+    SM_FileHandle fh;
+
+    initStorageManager();
+
+    // create the page file once with enough pages so misses never grow the file
+    CHECK(createPageFile(BENCH_FILE));
+    CHECK(openPageFile(BENCH_FILE, &fh));
+    CHECK(ensureCapacity(NUM_MISSES, &fh));
+    CHECK(closePageFile(&fh));
+
+    const ReplacementStrategy strategies[] = {RS_LRU, RS_CLOCK, RS_LRU_K, RS_LFU, RS_ARC};
+    const int numStrategies = 5;
+
+    // the frame memory is only touched when a frame is first used
+    printf("%10s %10s %14s\n", "huge pages", "frames", "ms/init");
+    for (int hugePages = HP_NONE; hugePages <= HP_EXPLICIT; hugePages++)
+        benchStartup(maxFrames, hugePages);
+
+    // search a pool whose frames are all pinned but the last one
+    printf("\n%10s %10s %14s\n", "layout", "frames", "Gframes/s");
+    benchScan(maxFrames);
+
+    printf("\n%10s %10s %14s\n", "strategy", "frames", "ns/miss");
+    for (int s = 0; s < numStrategies; s++)
+        for (int numFrames = 16; numFrames <= maxFrames; numFrames *= 4)
+            benchMissLatency(numFrames, strategies[s]);
+
+    // scale the threads up to the core count, with a single partition and with 16
+    int numCores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    printf("\n%10s %10s %14s\n", "threads", "partitions", "Mpins/s");
+    for (int numThreads = 1; numThreads <= numCores; numThreads *= 2)
+    {
+        benchThroughput(numThreads, 1);
+        benchThroughput(numThreads, 16);
+    }
+
+    CHECK(destroyPageFile(BENCH_FILE));
+    return 0;
+}
+
+double
+nowNs (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+const char *
+stratName (ReplacementStrategy strategy)
+{
+    switch (strategy)
+    {
+    case RS_FIFO: return "FIFO";
+    case RS_LRU: return "LRU";
+    case RS_CLOCK: return "CLOCK";
+    case RS_LFU: return "LFU";
+    case RS_LRU_K: return "LRU-K";
+    case RS_ARC: return "ARC";
+    default: return "?";
+    }
+}
+
+// pin and unpin NUM_MISSES distinct pages, pools smaller than that evict on every miss
+void
+benchMissLatency (int numFrames, ReplacementStrategy strategy)
+{
+    BM_BufferPool bm;
+    BM_PageHandle h;
+
+    CHECK(initBufferPool(&bm, BENCH_FILE, numFrames, strategy, NULL));
+
+    double start = nowNs();
+    for (int i = 0; i < NUM_MISSES; i++)
+    {
+        CHECK(pinPage(&bm, &h, i));
+        CHECK(unpinPage(&bm, &h));
+    }
+    double elapsed = nowNs() - start;
+
+    printf("%10s %10i %14.1f\n", stratName(strategy), numFrames, elapsed / NUM_MISSES);
+    CHECK(shutdownBufferPool(&bm));
+}
+
+// initialize and shut down an empty pool
+void
+benchStartup (int numFrames, HugePages hugePages)
+{
+    const char *names[] = {"none", "transparent", "explicit"};
+    BM_PoolOptions options = {0};
+    BM_BufferPool bm;
+
+    options.hugePages = hugePages;
+    double start = nowNs();
+    CHECK(initBufferPoolWithOptions(&bm, BENCH_FILE, numFrames, RS_LRU, NULL, &options));
+    double elapsed = nowNs() - start;
+
+    printf("%10s %10i %14.2f\n", names[hugePages], numFrames, elapsed / 1e6);
+    CHECK(shutdownBufferPool(&bm));
+}
+
+// find the only unpinned frame with a loop over frame records, with a loop over the fix
+// count array, and with the vector kernel pinPage uses
+void
+benchScan (int numFrames)
+{
+    AoSFrame *frames = calloc(numFrames, sizeof(AoSFrame));
+    int *fixCounts = calloc(numFrames, sizeof(int));
+    int found = 0;
+
+    for (int i = 0; i < numFrames - 1; i++)
+    {
+        frames[i].fixCount = 1;
+        fixCounts[i] = 1;
+    }
+
+    double start = nowNs();
+    for (int r = 0; r < NUM_SCANS; r++)
+    {
+        // the volatile read keeps the compiler from hoisting the scan out of the loop
+        for (int i = 0; i < numFrames; i++)
+        {
+            if (((volatile AoSFrame *)frames)[i].fixCount == 0)
+            {
+                found += i;
+                break;
+            }
+        }
+    }
+    double aos = nowNs() - start;
+
+    start = nowNs();
+    for (int r = 0; r < NUM_SCANS; r++)
+        found += findUnpinnedScalar(fixCounts, 0, numFrames);
+    double scalar = nowNs() - start;
+
+    start = nowNs();
+    for (int r = 0; r < NUM_SCANS; r++)
+        found += findUnpinned(fixCounts, 0, numFrames);
+    double vector = nowNs() - start;
+
+    printf("%10s %10i %14.2f\n", "records", numFrames, (double)NUM_SCANS * numFrames / aos);
+    printf("%10s %10i %14.2f\n", "array", numFrames, (double)NUM_SCANS * numFrames / scalar);
+    printf("%10s %10i %14.2f\n", "vector", numFrames, (double)NUM_SCANS * numFrames / vector);
+
+    // use the results so the scans are not optimized away
+    if (found != 3 * NUM_SCANS * (numFrames - 1))
+        printf("scan found the wrong frame\n");
+    free(frames);
+    free(fixCounts);
+}
+
+// pin and unpin random pages of the file
+void *
+pinRandomPages (void *arg)
+{
+    unsigned int seed = (unsigned int)(long)arg + 1;
+    BM_PageHandle h;
+
+    for (int i = 0; i < NUM_PINS; i++)
+    {
+        CHECK(pinPage(&throughputPool, &h, rand_r(&seed) % NUM_MISSES));
+        CHECK(unpinPage(&throughputPool, &h));
+    }
+    return NULL;
+}
+
+// run pinRandomPages in numThreads threads against a concurrent LRU pool
+void
+benchThroughput (int numThreads, int numPartitions)
+{
+    BM_PoolOptions options = {0};
+    pthread_t threads[numThreads];
+
+    options.concurrent = true;
+    options.numPartitions = numPartitions;
+    CHECK(initBufferPoolWithOptions(&throughputPool, BENCH_FILE, THROUGHPUT_FRAMES, RS_LRU, NULL, &options));
+
+    double start = nowNs();
+    for (long i = 0; i < numThreads; i++)
+        pthread_create(&threads[i], NULL, pinRandomPages, (void *)i);
+    for (int i = 0; i < numThreads; i++)
+        pthread_join(threads[i], NULL);
+    double elapsed = nowNs() - start;
+
+    printf("%10i %10i %14.2f\n", numThreads, numPartitions, 1e3 * numThreads * NUM_PINS / elapsed);
+    CHECK(shutdownBufferPool(&throughputPool));
+}
@@ -1,14 +1,87 @@
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
 #include "hash_table.h"
+#include "freq_sketch.h"
 #include <stdlib.h>
-#include <limits.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+// the victim searches use SSE2 or AVX2 when the CPU has them
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86
+#endif
+#include <pthread.h>
+#include <time.h>
 
 /* Additional Definitions */
 
-#define PAGE_TABLE_SIZE 256
+// marks the end of an intrusive frame list
+#define NO_FRAME -1
+
+// LRU-K uses K = 2 unless stratData points to an int holding K
+#define DEFAULT_LRU_K 2
+
+// LFU frequencies saturate at this value, and unless stratData points to an int holding the
+// aging period, all frequencies are halved after this many references per frame
+#define LFU_MAX_FREQUENCY 255
+#define LFU_AGING_FACTOR 8
+
+// with TinyLFU admission, pages that lose against the victim are served from scratch frames
+#define ADMISSION_SCRATCH_FRAMES 1
+
+// ARC lists a frame's page can belong to
+#define ARC_NONE 0
+#define ARC_T1 1
+#define ARC_T2 2
+
+// background writer defaults: wake up every 10ms, write up to 16 pages per round and 
+// partition, start at 10% dirty frames and stop at 5%, look at 4 frames per page to write
+#define WRITER_INTERVAL_MS 10
+#define WRITER_PAGES_PER_ROUND 16
+#define WRITER_HIGH_WATERMARK 10
+#define WRITER_LOW_WATERMARK 5
+#define WRITER_SCAN_FACTOR 4
+
+// the frame arena is aligned to and sized in multiples of this when it uses huge pages
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// a mapped pool switches the mapping to sequential read-ahead once its misses look like a
+// scan (each sequential miss adds one to a score, others subtract one) and back to random 
+// once the score drops to 0, a scan asks for the next MAPPED_READAHEAD pages at a time
+#define MAPPED_SEQUENTIAL_SCORE 8
+#define MAPPED_READAHEAD 64
 
-typedef unsigned int TimeStamp;
+// a frame is READING while its page is read from disk, pins of the page wait for the read
+// (and fail if the frame ends up FAILED, i.e. the read failed and the page was unmapped)
+#define FRAME_READY 0
+#define FRAME_READING 1
+#define FRAME_FAILED 2
+
+// the most page files a pool serves at once (file ids range from 0 to MAX_POOL_FILES - 1)
+#define MAX_POOL_FILES 1024
+
+// the file id getFlushFrames takes to collect the dirty frames of every file
+#define ALL_FILES -1
+
+// a concurrent pool that shrinks waits up to this long for the frames it releases to be 
+// unpinned, checking them again every SHRINK_POLL_MS
+#define SHRINK_TIMEOUT_MS 1000
+#define SHRINK_POLL_MS 1
+
+// a broken asynchronous I/O queue is polled this long for the runs still in flight before 
+// they are given up as failed
+#define ASYNC_DRAIN_TIMEOUT_MS 1000
+
+// results of reserveFrame
+#define RESERVE_READING 0
+#define RESERVE_RESIDENT 1
+#define RESERVE_FULL 2
+#define RESERVE_WRITE_FAILED 3
+
+// logical clock used to order page references
+typedef unsigned long long TimeStamp;
 
 typedef struct BM_PageFrame {
     // the frame's buffer
@@ -17,39 +90,470 @@ typedef struct BM_PageFrame {
     PageNumber pageNum;
     // management data on the page frame
     int frameIndex;
-    int fixCount;
     bool dirty;
     bool occupied;
-    TimeStamp timeStamp;
+    // LFU reference count
+    int frequency;
+    // ARC list of the page (ARC_T1 after one reference, ARC_T2 after more)
+    int arcList;
+    // links in the LRU recency list or LFU bucket (only unpinned frames are linked)
+    bool linked;
+    int prev;
+    int next;
+    // position in the LRU-K victim heap (NO_FRAME if pinned)
+    int heapPos;
+    // ARC: set when the frame is chosen as a victim that must not be remembered in B1
+    bool arcForget;
+    // FRAME_READY, FRAME_READING or FRAME_FAILED, the latch is held while the frame's data is written
+    int state;
+    // the page the page table maps to the frame, a miss sets it to NO_PAGE before it checks
+    // that no hit pinned the frame, and hits check it after pinning the frame they looked up
+    PageNumber tablePage;
+    pthread_mutex_t latch;
 } BM_PageFrame;
 
+// a frame reserved by prefetchPages that a prefetch thread has to read
+typedef struct BM_PrefetchRequest {
+    BM_BufferPool *pool;
+    BM_PageFrame *frame;
+    struct BM_PrefetchRequest *next;
+} BM_PrefetchRequest;
+
+// a frame reserved by pinPages, index is the position of its page in the caller's arrays,
+// result is the result of reading the frame's page
+typedef struct BM_FrameRef {
+    BM_BufferPool *pool;
+    BM_PageFrame *frame;
+    int index;
+    RC result;
+} BM_FrameRef;
+
+// a page file the pool serves, with the file latch and asynchronous I/O queue of its handle
+typedef struct BM_File {
+    SM_FileHandle pageFile;
+    // the name it was registered under and how many registrations were not undone yet
+    char *fileName;
+    int numRegistrations;
+    pthread_rwlock_t fileLatch;
+    bool async;
+    SM_AsyncIO asyncIO;
+    pthread_mutex_t asyncLatch;
+    // the queue stopped finishing requests, the file's transfers are synchronous from then on
+    bool asyncStalled;
+    // the advice given for its mapping in a mapped pool
+    SM_Advice advice;
+} BM_File;
+
+// a part of the sorted dirty frames that one flush thread writes
+typedef struct BM_FlushTask {
+    BM_FrameRef *refs;
+    int numRefs;
+    RC result;
+    pthread_t thread;
+    bool started;
+} BM_FlushTask;
+
 typedef struct BM_Metadata {
-    // an array of frames
+    // an array of frames: the pool's numPages frames, the frames it can grow into up to 
+    // maxFrames (they are empty and unknown to the replacement policies), and then the 
+    // scratch frames
     BM_PageFrame *pageFrames;
+    int numFrames;
+    int maxFrames;
+    // the fields the replacement scans read are kept in arrays indexed like pageFrames, so a
+    // scan only touches them (and can compare several frames per instruction): the fix 
+    // counts, and the CLOCK reference bits that are set on access and cleared by the hand
+    int *fixCounts;
+    unsigned char *refBits;
     // a page table that associates the a page ID with an index in pageFrames
     HT_TableHandle pageTable;
-    // the file handle
-    SM_FileHandle pageFile;
-    // increments everytime a page is accessed (used for frame's timeStamp)
-    TimeStamp timeStamp;
+    // the owner's page files indexed by file id (NULL for free ids), the pool's own file has
+    // id 0, and the latch that registering and unregistering hold exclusively, operations 
+    // that read or write pages of the files hold it shared so no file is closed under them
+    BM_File **files;
+    int numFileIds;
+    pthread_rwlock_t filesLatch;
+    // the settings the owner opens its files with
+    int openFlags;
+    int preallocatePages;
+    int ioQueueDepth;
     // used to treat *pageFrames as a queue
     int queueIndex;
+    // recency list of unpinned frames, head is the least recently used
+    int lruHead;
+    int lruTail;
+    // the frame the CLOCK hand points at next, and whether the last victim it chose was only 
+    // found by a second sweep (every unpinned frame was referenced)
+    int clockHand;
+    bool clockSwept;
+    // LRU-K: the last k reference times of each frame's page, most recent first
+    // (a time of 0 means the page has fewer than k references)
+    int k;
+    TimeStamp timeStamp;
+    TimeStamp *history;
+    // LRU-K: min-heap of unpinned frames ordered by backward k-distance
+    int *heap;
+    int heapSize;
+    // LRU-K and ARC: pages evicted recently, ghostTable maps them to a slot in ghostPages
+    HT_TableHandle ghostTable;
+    PageNumber *ghostPages;
+    // LRU-K: the ghosts form a bounded ring of reference histories
+    TimeStamp *ghostHistory;
+    int ghostCursor;
+    // LFU: one recency list of unpinned frames per frequency, and the lowest frequency that
+    // may be non-empty
+    int bucketHead[LFU_MAX_FREQUENCY + 1];
+    int bucketTail[LFU_MAX_FREQUENCY + 1];
+    int minFrequency;
+    // LFU: references left until the next aging
+    int agingPeriod;
+    int agingCountdown;
+    // ARC: recency lists of the unpinned frames in T1 and T2 (empty frames wait in the LRU
+    // list), the sizes of T1 and T2 including pinned frames, and the target size of T1
+    int t1Head;
+    int t1Tail;
+    int t2Head;
+    int t2Tail;
+    int t1Size;
+    int t2Size;
+    int arcTarget;
+    // ARC: the ghost lists B1 and B2 are linked through ghostPrev and ghostNext, unused
+    // slots are chained through ghostNext starting at ghostFree
+    int *ghostPrev;
+    int *ghostNext;
+    int *ghostList;
+    int b1Head;
+    int b1Tail;
+    int b2Head;
+    int b2Tail;
+    int b1Size;
+    int b2Size;
+    int ghostFree;
+    // TinyLFU: access frequencies of all requested pages
+    bool admission;
+    FS_SketchHandle sketch;
     // statistics
-    int numRead;
-    int numWrite;
+    long long numRead;
+    long long numWrite;
+    // the number of dirty frames, and whether the background writer is cleaning the pool
+    // (it starts at the high watermark and stops at the low one)
+    int numDirty;
+    int dirtyHigh;
+    int dirtyLow;
+    bool writerCleaning;
+    // the watermarks in percent of the frames, dirtyHigh and dirtyLow follow the pool's size
+    int highWatermark;
+    int lowWatermark;
+    // latches of a concurrent pool (they are not used otherwise), the table latch serializes
+    // the changes of the page table (lookups take no latch) and is taken before the policy 
+    // latch, the storage manager reads and writes at fixed offsets, so page I/O only takes 
+    // the latch of its file shared and it is taken exclusively to grow the file
+    bool concurrent;
+    bool latchHits;
+    pthread_mutex_t tableLatch;
+    pthread_mutex_t policyLatch;
+    // pins of READING frames wait for readDone
+    pthread_mutex_t readLatch;
+    pthread_cond_t readDone;
+    // the pool that owns the page files (the pool itself unless it is a partition)
+    struct BM_Metadata *owner;
+    // a partitioned pool has no frames of its own, it forwards every page to one of its 
+    // partitions, which are independent pools
+    int numPartitions;
+    BM_BufferPool *partitions;
+    // a copy of the pool handle for the owner's threads
+    BM_BufferPool poolHandle;
+    // the background writer thread of the owner
+    bool writer;
+    pthread_t writerThread;
+    pthread_mutex_t writerLatch;
+    pthread_cond_t writerWake;
+    bool writerStop;
+    int writerIntervalMs;
+    int writerPagesPerRound;
+    // the owner's prefetch threads, the queue of reserved frames they read and the number of
+    // requests that are queued or being read
+    int numPrefetchThreads;
+    pthread_t *prefetchThreads;
+    pthread_mutex_t prefetchLatch;
+    pthread_cond_t prefetchWake;
+    pthread_cond_t prefetchIdle;
+    BM_PrefetchRequest *prefetchHead;
+    BM_PrefetchRequest *prefetchTail;
+    int numPrefetches;
+    bool prefetchStop;
+    // the number of threads forceFlushPool spreads the writes of the owner over
+    int numFlushThreads;
+    // serializes the owner's resizes
+    pthread_mutex_t resizeLatch;
+    // in a pool of the owner's read-only mappings frames point into the mappings, the last 
+    // miss and the sequential score follow the access pattern (the advice given for each 
+    // mapping is kept with its file)
+    bool mapped;
+    PageNumber lastMiss;
+    int sequentialScore;
+    // the owner's arena holding the data of all frames (partitions included), it is mapped 
+    // lazily so a frame only gets physical memory once it is first written
+    char *arena;
+    size_t arenaSize;
 } BM_Metadata;
 
 /* Declarations */
 
+// use this helper to set up the frames and replacement state of a pool or partition whose 
+// owner, concurrent flag and partitions are already set, it can grow to maxPages frames
+void initPool(BM_BufferPool *const bm, BM_Metadata *metadata, const int numPages, const int maxPages,
+        ReplacementStrategy strategy, int k, int agingPeriod, const BM_PoolOptions *options, char *arena);
+
+// use this helper to set the numbers of dirty frames the background writer starts and stops 
+// at for a pool or partition of numPages frames
+void setWatermarks(BM_Metadata *metadata, int numPages);
+
+// use these helpers to resize a pool or partition (not a partitioned pool) to numPages 
+// frames: shrinkPool writes and evicts the pages of the frames past numPages and releases 
+// their memory (RC_WRITE_FAILED if one of them stays pinned, then the pool keeps its size),
+// growPool adds frames up to numPages as empty frames
+RC shrinkPool(BM_BufferPool *const bm, int numPages);
+void growPool(BM_BufferPool *const bm, int numPages);
+
+// use these helpers to take an empty or evicted frame out of the replacement state when 
+// the pool shrinks and to add an empty frame as the next victim when it grows (call them 
+// with the policy latch)
+void detachFrame(BM_BufferPool *const bm, BM_PageFrame *frame);
+void attachFrame(BM_BufferPool *const bm, BM_PageFrame *frame);
+
+// use this helper to map a page-aligned arena of at least size bytes, NULL if it fails
+char *mapArena(size_t size, HugePages hugePages, size_t *mappedSize);
+
+// use this helper to get the partition of a partitioned pool that pageNum belongs to
+BM_BufferPool *getPartition(BM_BufferPool *const bm, PageNumber pageNum);
+
+// use these helpers to set and clear a frame's dirty bool, they keep numDirty up to date
+// (clearDirty returns whether the frame was dirty)
+void setDirty(BM_Metadata *metadata, BM_PageFrame *frame);
+bool clearDirty(BM_Metadata *metadata, BM_PageFrame *frame);
+
+// the background writer thread's main loop, arg is the owner's metadata
+void *runBackgroundWriter(void *arg);
+
+// use this helper to stop the owner's background writer (if it has one) and wait for it
+void stopBackgroundWriter(BM_Metadata *metadata);
+
+// use this helper to start reading pageNum into a frame of a pool or partition
+RC prefetchPage(BM_BufferPool *const bm, PageNumber pageNum);
+
+// the prefetch threads' main loop, arg is the owner's metadata
+void *runPrefetcher(void *arg);
+
+// use these helpers to wait until the owner's prefetch threads (if any) finished the queued 
+// reads, and to let them finish the queued reads and stop them (later prefetches read 
+// synchronously)
+void waitForPrefetches(BM_Metadata *metadata);
+void stopPrefetchers(BM_Metadata *metadata);
+
+// use this helper to let the background writer clean one pool or partition, frames has room
+// for writerPagesPerRound frame indexes
+void cleanPool(BM_BufferPool *const bm, int *frames);
+
+// use this helper to list up to maxFrames dirty, unpinned frames near the eviction end of 
+// the replacement order (call it with the policy latch)
+int getDirtyVictims(BM_BufferPool *const bm, int *frames, int maxFrames);
+void addDirtyVictim(BM_Metadata *metadata, int frameIndex, int *frames, int *numFrames);
+
 BM_PageFrame *replacementFIFO(BM_BufferPool *const bm);
 
 BM_PageFrame *replacementLRU(BM_BufferPool *const bm);
 
-// use this helper to increment the pool's global timestamp and return it
+BM_PageFrame *replacementCLOCK(BM_BufferPool *const bm);
+
+BM_PageFrame *replacementLRUK(BM_BufferPool *const bm);
+
+BM_PageFrame *replacementLFU(BM_BufferPool *const bm);
+
+BM_PageFrame *replacementARC(BM_BufferPool *const bm, PageNumber pageNum);
+
+// the replacement functions only choose a victim, use this helper to apply what choosing it 
+// changes in the policy (the FIFO queue index, the CLOCK hand and reference bits, the ARC 
+// target and ghost lists) once the victim is claimed and admitted
+void commitVictim(BM_BufferPool *const bm, PageNumber pageNum, BM_PageFrame *victim);
+
+// use this helper to get the ARC target size of T1 adapted to a ghost hit of pageNum, list
+// gets the ghost list pageNum is in (ARC_NONE if it is not a ghost)
+int arcAdaptTarget(BM_BufferPool *const bm, PageNumber pageNum, int *list);
+
+// use this helper whenever a frame is accessed (pinned, unpinned, dirtied, or written)
+// to keep the replacement bookkeeping up to date, call it after changing fixCount
+void accessFrame(BM_BufferPool *const bm, BM_PageFrame *frame);
+
+// use this helper whenever a page is referenced (pinned), call it after accessFrame
+void referenceFrame(BM_BufferPool *const bm, BM_PageFrame *frame);
+
+// use these helpers when a page leaves a frame (before it is overwritten) and when a 
+// new page was loaded into a frame
+void retireFrame(BM_BufferPool *const bm, BM_PageFrame *frame);
+void installFrame(BM_BufferPool *const bm, BM_PageFrame *frame);
+
+// use these helpers to unlink a frame from, append a frame to, or prepend a frame to an 
+// intrusive frame list (the LRU recency list or an LFU bucket)
+void listUnlink(BM_PageFrame *pageFrames, int *head, int *tail, BM_PageFrame *frame);
+void listAppend(BM_PageFrame *pageFrames, int *head, int *tail, BM_PageFrame *frame);
+void listPrepend(BM_PageFrame *pageFrames, int *head, int *tail, BM_PageFrame *frame);
+
+// use this helper to get the first unpinned frame of an intrusive frame list (NO_FRAME if there
+// is none), pinned frames in front of it are unlinked (hits may pin frames without unlinking them)
+int listHead(BM_Metadata *metadata, int *head, int *tail);
+
+// use this helper to decide if pageNum is requested often enough to evict the victim's page
+bool admitPage(BM_BufferPool *const bm, PageNumber pageNum, BM_PageFrame *victim);
+
+// use this helper to find a scratch frame that is not pinned (NULL if there is none)
+BM_PageFrame *getScratchFrame(BM_BufferPool *const bm);
+
+// use this helper to halve all LFU frequencies
+void lfuAge(BM_BufferPool *const bm);
+
+// use these helpers to add a page to the MRU end of ARC ghost list B1 or B2 and to drop a ghost
+void ghostPush(BM_Metadata *metadata, int list, PageNumber pageNum);
+void ghostDrop(BM_Metadata *metadata, int slot);
+
+// use these helpers to find the first frame in [from, to) that is unpinned (and whose CLOCK 
+// reference bit is clear), NO_FRAME if there is none, they dispatch to the widest vector 
+// kernel the CPU supports (a concurrent pool uses the scalar kernels, whose loads are atomic
+// since hits change the fix counts and reference bits without a latch)
+int findUnpinned(BM_Metadata *metadata, int from, int to);
+int findUnreferenced(BM_Metadata *metadata, int from, int to);
+int findUnpinnedScalar(const int *fixCounts, int from, int to);
+int findUnreferencedScalar(const int *fixCounts, const unsigned char *refBits, int from, int to);
+#ifdef SIMD_X86
+int findUnpinnedSSE2(const int *fixCounts, int from, int to);
+int findUnpinnedAVX2(const int *fixCounts, int from, int to);
+int findUnreferencedSSE2(const int *fixCounts, const unsigned char *refBits, int from, int to);
+int findUnreferencedAVX2(const int *fixCounts, const unsigned char *refBits, int from, int to);
+#endif
+
+// use this helper to clear the CLOCK reference bits of the unpinned frames in [from, to)
+void clearReferences(BM_Metadata *metadata, int from, int to);
+
+// use this helper to read the fix count of a frame, hits change it without a latch
+int fixCountOf(BM_Metadata *metadata, int frameIndex);
+
+// use these helpers to maintain the LRU-K victim heap
+bool lruKBefore(BM_Metadata *metadata, int frameA, int frameB);
+void heapInsert(BM_Metadata *metadata, BM_PageFrame *frame);
+void heapRemove(BM_Metadata *metadata, BM_PageFrame *frame);
+void heapMove(BM_Metadata *metadata, int pos);
+
+// use this helper to increment the pool's logical clock and return it
 TimeStamp getTimeStamp(BM_Metadata *metadata);
 
-// use this help to evict the frame at frameIndex (write if occupied and dirty) and return the new empty frame
-BM_PageFrame *getAfterEviction(BM_BufferPool *const bm, int frameIndex);
+// use this helper to choose and claim (pin) the frame a missing page is loaded into, NULL if 
+// all frames are pinned (the replacement policies only choose the victim, pinPage evicts it)
+BM_PageFrame *getVictim(BM_BufferPool *const bm, PageNumber pageNum);
+
+// use this helper to pin pageNum if it is in the page table, RC_IM_KEY_NOT_FOUND otherwise
+RC pinResident(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+
+// use this helper to load pageNum into a frame after a page table miss
+RC loadPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum);
+
+// use this helper to map pageNum to a victim frame before reading it, it returns
+// RESERVE_READING with the pinned frame the caller must read and finishRead, RESERVE_RESIDENT
+// with the pinned frame if the page got loaded meanwhile, RESERVE_FULL, or 
+// RESERVE_WRITE_FAILED if the victim's dirty page could not be written (it stays dirty)
+int reserveFrame(BM_BufferPool *const bm, PageNumber pageNum, BM_PageFrame **frame);
+
+// use these helpers to mark a reserved frame as read and to wait until a frame is read
+void finishRead(BM_Metadata *metadata, BM_PageFrame *frame);
+void waitForRead(BM_Metadata *metadata, BM_PageFrame *frame);
+
+// use this helper instead of finishRead if the read of a reserved frame failed, it unmaps 
+// the page, empties the frame and drops the pin (the pins that waited for the read fail)
+void failRead(BM_BufferPool *const bm, BM_PageFrame *frame);
+
+// use this helper to finish pinning a page whose frame was found in the page table and whose 
+// fixCount was already incremented (counted tells if TinyLFU already counted the request)
+RC pinFrame(BM_BufferPool *const bm, BM_PageHandle *const page, BM_PageFrame *frame, bool counted);
+
+// use these helpers to pin an unpinned frame (false if it got pinned meanwhile) and to drop 
+// a pin again
+bool claimFrame(BM_Metadata *metadata, BM_PageFrame *frame);
+void releaseFrame(BM_BufferPool *const bm, BM_PageFrame *frame);
+
+// use these helpers to open a page file of the owner under a free file id and to close it
+// again (it frees the id)
+RC openFile(BM_Metadata *owner, int fileId, const char *fileName);
+void closeFile(BM_Metadata *owner, int fileId);
+
+// use this helper to get the file a page of the owner belongs to
+BM_File *fileOf(BM_Metadata *owner, PageNumber pageNum);
+
+// use this helper to tell if a frame of the owner (or one of its partitions) holds a page 
+// of fileId, pinnedOnly only looks at pinned frames
+bool fileCached(BM_Metadata *owner, int fileId, bool pinnedOnly);
+
+// use these helpers to check a page before it is pinned: it must not be negative and its 
+// file must be registered (checkFile, it does not touch the file), and it must lie inside 
+// the file of a mapped pool (checkPage, call it with the files latch)
+RC checkFile(BM_Metadata *metadata, PageNumber pageNum);
+RC checkPage(BM_Metadata *metadata, PageNumber pageNum);
+
+// use this helper to grow a page file of the owner to at least numberOfPages pages, it 
+// returns with the file latch held shared (in a concurrent pool) whether it succeeds or not, 
+// oldNumPages gets the size of the file before it grew (pages from there on are all zeros)
+RC growFile(BM_Metadata *owner, BM_File *file, PageNumber numberOfPages, PageNumber *oldNumPages);
+
+// use this helper to zero the frames of refs that lie at or past page oldNumPages of their 
+// file (they were just added to it, so there is nothing to read), it returns how many refs
+// come before them
+int zeroNewFrames(BM_FrameRef *refs, int numRefs, PageNumber oldNumPages);
+
+// use this helper to get the end of the refs from start on whose pages are in the same file
+int fileRunEnd(BM_FrameRef *refs, int start, int numRefs);
+
+// use these helpers to read a frame's page from disk (growing the file if needed) and to 
+// write it back, both count the I/O
+RC readFrame(BM_Metadata *metadata, BM_PageFrame *frame);
+
+// use this helper to read the pages of frames sorted by page number, each run of consecutive
+// pages is read with a single vectored read (the result of each frame is set in its ref)
+RC readFrames(BM_FrameRef *refs, int numRefs);
+
+// use this helper after every miss of a mapped pool to adapt the advice for its mapping
+void adviseMapping(BM_Metadata *owner, PageNumber pageNum);
+int compareFrameRefs(const void *refA, const void *refB);
+
+// use this helper to write the dirty, unpinned frames of a pool (or of all its partitions) 
+// that hold pages of fileId (ALL_FILES for all of them)
+RC flushPool(BM_BufferPool *const bm, int fileId);
+
+// use this helper to pin the dirty, unpinned frames of a pool or partition that hold pages 
+// of fileId and clear their dirty bools, it adds them to refs and returns how many it added
+int getFlushFrames(BM_BufferPool *const bm, BM_FrameRef *refs, int fileId);
+
+// use this helper to write the pinned frames sorted by page number with a vectored write per 
+// run of consecutive pages, spread over the owner's flush threads
+RC flushFrames(BM_Metadata *owner, BM_FrameRef *refs, int numRefs);
+
+// use this helper to read or write the pinned frames of one file sorted by page number 
+// through the file's asynchronous I/O queue, keeping up to its queue depth of runs in flight
+RC transferFramesAsync(BM_Metadata *owner, BM_File *file, BM_FrameRef *refs, int numRefs, bool write);
+RC writeFrames(BM_FrameRef *refs, int numRefs);
+
+// the flush threads' main function, arg is a BM_FlushTask
+void *runFlush(void *arg);
+
+RC writeFrame(BM_Metadata *metadata, BM_PageFrame *frame);
+
+// use these helpers to take and release the latches of a concurrent pool, they do nothing 
+// for other pools
+void latchTable(BM_Metadata *metadata);
+void unlatchTable(BM_Metadata *metadata);
+void latchPolicy(BM_Metadata *metadata);
+void unlatchPolicy(BM_Metadata *metadata);
+void latchFrame(BM_Metadata *metadata, BM_PageFrame *frame);
+void unlatchFrame(BM_Metadata *metadata, BM_PageFrame *frame);
+void latchFiles(BM_Metadata *metadata);
+void unlatchFiles(BM_Metadata *metadata);
 
 /* Buffer Manager Interface Pool Handling */
 
@@ -57,39 +561,152 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
 		const int numPages, ReplacementStrategy strategy,
 		void *stratData)
 {
-    // initialize the metadata
+    return initBufferPoolWithOptions(bm, pageFileName, numPages, strategy, stratData, NULL);
+}
+
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName, 
+		const int numPages, ReplacementStrategy strategy,
+		void *stratData, const BM_PoolOptions *options)
+{
+    BM_PoolOptions defaults = {0};
+    if (options == NULL)
+        options = &defaults;
+
+    // fill in the background writer defaults, the writer runs alongside the caller's threads
+    BM_PoolOptions settings = *options;
+    if (settings.writerIntervalMs == 0)
+        settings.writerIntervalMs = WRITER_INTERVAL_MS;
+    if (settings.writerPagesPerRound == 0)
+        settings.writerPagesPerRound = WRITER_PAGES_PER_ROUND;
+    if (settings.dirtyHighWatermark == 0)
+        settings.dirtyHighWatermark = WRITER_HIGH_WATERMARK;
+    if (settings.dirtyLowWatermark == 0)
+        settings.dirtyLowWatermark = (WRITER_LOW_WATERMARK < settings.dirtyHighWatermark) ? WRITER_LOW_WATERMARK : 0;
+    if (settings.backgroundWriter || settings.prefetchThreads > 0)
+        settings.concurrent = true;
+    options = &settings;
+
+    // LRU-K reads K and LFU reads its aging period from stratData
+    int k = DEFAULT_LRU_K;
+    int agingPeriod = LFU_AGING_FACTOR * numPages;
+    if (strategy == RS_LRU_K && stratData != NULL)
+        k = *(int *)stratData;
+    if (strategy == RS_LFU && stratData != NULL)
+        agingPeriod = *(int *)stratData;
+
+    // every partition needs at least one frame, the pool can grow to maxPages frames
+    int numPartitions = (options->numPartitions > 1) ? options->numPartitions : 1;
+    int maxPages = (options->maxPages > 0) ? options->maxPages : numPages;
+    bool writerValid = options->writerIntervalMs > 0 && options->writerPagesPerRound > 0 
+            && options->dirtyLowWatermark >= 0 && options->dirtyLowWatermark <= options->dirtyHighWatermark 
+            && options->dirtyHighWatermark <= 100 && options->prefetchThreads >= 0 && options->flushThreads >= 0 && options->ioQueueDepth >= 0
+            && options->preallocatePages >= 0 && options->hugePages >= HP_NONE && options->hugePages <= HP_EXPLICIT;
+    if (k < 1 || agingPeriod < 1 || options->admissionSketchBytes < 0 || numPartitions > numPages 
+            || maxPages < numPages || !writerValid)
+    {
+        bm->mgmtData = NULL;
+        return RC_INVALID_STRATEGY_DATA;
+    }
+
+    // the pool owns its page files, its partitions (if any) share them, the pool's own file
+    // gets id 0
     BM_Metadata *metadata = (BM_Metadata *)malloc(sizeof(BM_Metadata));
-    HT_TableHandle *pageTabe = &(metadata->pageTable);
-    metadata->timeStamp = 0;
+    metadata->owner = metadata;
+    metadata->concurrent = options->concurrent;
+    metadata->files = (BM_File **)calloc(MAX_POOL_FILES, sizeof(BM_File *));
+    metadata->numFileIds = 1;
+    metadata->openFlags = (options->directIO ? SM_OPEN_DIRECT : 0) | (options->readOnlyMapping ? SM_OPEN_MAPPED : 0);
+    metadata->preallocatePages = options->preallocatePages;
+    metadata->ioQueueDepth = options->ioQueueDepth;
+    RC result = openFile(metadata, 0, pageFileName);
 
-    // start the queue from the last element as it gets incremented by one and modded 
-    // at the start of each call of replacementFIFO
-    metadata->queueIndex = bm->numPages - 1;
-    metadata->numRead = 0;
-    metadata->numWrite = 0;
-    RC result = openPageFile((char *)pageFileName, &(metadata->pageFile));
+    // all frames of the pool and its partitions (scratch frames and the frames it can grow 
+    // into included) share one arena, the frames have the page size of the file
+    if (result == RC_OK)
+    {
+        int numScratch = (options->admissionSketchBytes > 0) ? ADMISSION_SCRATCH_FRAMES * numPartitions : 0;
+        metadata->arena = mapArena((size_t)(maxPages + numScratch) * metadata->files[0]->pageFile.pageSize, options->hugePages, &(metadata->arenaSize));
+        if (metadata->arena == NULL)
+        {
+            closeFile(metadata, 0);
+            result = RC_WRITE_FAILED;
+        }
+    }
     if (result == RC_OK)
     {
-        initHashTable(pageTabe, PAGE_TABLE_SIZE);
-        metadata->pageFrames = (BM_PageFrame *)malloc(sizeof(BM_PageFrame) * numPages);
-        for (int i = 0; i < numPages; i++)
+        metadata->numFlushThreads = options->flushThreads;
+        pthread_rwlock_init(&(metadata->filesLatch), NULL);
+        pthread_mutex_init(&(metadata->resizeLatch), NULL);
+        metadata->mapped = options->readOnlyMapping;
+        metadata->lastMiss = NO_PAGE;
+        metadata->sequentialScore = 0;
+        if (numPartitions > 1)
+        {
+            // the frames are split as evenly as possible, the pool itself has none
+            metadata->numPartitions = numPartitions;
+            metadata->partitions = (BM_BufferPool *)malloc(sizeof(BM_BufferPool) * numPartitions);
+            metadata->pageFrames = NULL;
+            metadata->numFrames = 0;
+            metadata->maxFrames = 0;
+            metadata->numRead = 0;
+            metadata->numWrite = 0;
+            char *arena = metadata->arena;
+            for (int i = 0; i < numPartitions; i++)
+            {
+                BM_Metadata *partition = (BM_Metadata *)malloc(sizeof(BM_Metadata));
+                partition->owner = metadata;
+                partition->concurrent = options->concurrent;
+                partition->numPartitions = 0;
+                partition->partitions = NULL;
+                initPool(&(metadata->partitions[i]), partition, numPages / numPartitions + (i < numPages % numPartitions), 
+                        maxPages / numPartitions + (i < maxPages % numPartitions), strategy, k, agingPeriod, options, arena);
+                arena += (size_t)partition->numFrames * metadata->files[0]->pageFile.pageSize;
+            }
+        }
+        else 
         {
-            metadata->pageFrames[i].frameIndex = i;
-            metadata->pageFrames[i].data = (char *)malloc(PAGE_SIZE);
-            metadata->pageFrames[i].fixCount = 0;
-            metadata->pageFrames[i].dirty = false;
-            metadata->pageFrames[i].occupied = false;
-            metadata->pageFrames[i].timeStamp = getTimeStamp(metadata);
+            metadata->numPartitions = 0;
+            metadata->partitions = NULL;
+            initPool(bm, metadata, numPages, maxPages, strategy, k, agingPeriod, options, metadata->arena);
         }
         bm->mgmtData = (void *)metadata;
         bm->numPages = numPages;
-        bm->pageFile = (char *)&(metadata->pageFile);
+        bm->pageFile = (char *)&(metadata->files[0]->pageFile);
         bm->strategy = strategy;
+
+        // start the background writer and prefetch threads last, they work on a copy of the 
+        // finished pool handle
+        metadata->poolHandle = *bm;
+        metadata->writer = options->backgroundWriter;
+        if (metadata->writer)
+        {
+            metadata->writerStop = false;
+            metadata->writerIntervalMs = options->writerIntervalMs;
+            metadata->writerPagesPerRound = options->writerPagesPerRound;
+            pthread_mutex_init(&(metadata->writerLatch), NULL);
+            pthread_cond_init(&(metadata->writerWake), NULL);
+            pthread_create(&(metadata->writerThread), NULL, runBackgroundWriter, metadata);
+        }
+        metadata->numPrefetchThreads = options->prefetchThreads;
+        if (metadata->numPrefetchThreads > 0)
+        {
+            metadata->prefetchHead = metadata->prefetchTail = NULL;
+            metadata->numPrefetches = 0;
+            metadata->prefetchStop = false;
+            pthread_mutex_init(&(metadata->prefetchLatch), NULL);
+            pthread_cond_init(&(metadata->prefetchWake), NULL);
+            pthread_cond_init(&(metadata->prefetchIdle), NULL);
+            metadata->prefetchThreads = (pthread_t *)malloc(sizeof(pthread_t) * metadata->numPrefetchThreads);
+            for (int i = 0; i < metadata->numPrefetchThreads; i++)
+                pthread_create(&(metadata->prefetchThreads[i]), NULL, runPrefetcher, metadata);
+        }
         return RC_OK;
     }
     else
     {
-        // in case the file can't be open, set the metadata to NULL
+        // in case the file can't be open (or the arena can't be mapped), set the metadata to NULL
+        free(metadata->files);
+        free(metadata);
         bm->mgmtData = NULL;
         return result;
     }
@@ -103,23 +720,105 @@ RC shutdownBufferPool(BM_BufferPool *const bm)
         BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
         BM_PageFrame *pageFrames = metadata->pageFrames;
         HT_TableHandle *pageTabe = &(metadata->pageTable);
+
+        // wait for the prefetches in flight, they pin their frames until they are read (the 
+        // prefetch threads only stop once the pool is known to shut down)
+        if (metadata->owner == metadata)
+            waitForPrefetches(metadata);
         
+        // shut the partitions down, but only if none of them has pinned pages
+        if (metadata->partitions != NULL)
+        {
+            for (int p = 0; p < metadata->numPartitions; p++)
+            {
+                BM_Metadata *partition = (BM_Metadata *)metadata->partitions[p].mgmtData;
+                for (int i = 0; i < partition->numFrames; i++)
+                {
+                    if (fixCountOf(partition, i) > 0) return RC_WRITE_FAILED;
+                }
+            }
+            stopPrefetchers(metadata);
+            stopBackgroundWriter(metadata);
+
+            // flush all partitions at once so their pages are written in one sorted pass
+            forceFlushPool(bm);
+            for (int p = 0; p < metadata->numPartitions; p++)
+                shutdownBufferPool(&(metadata->partitions[p]));
+            free(metadata->partitions);
+            munmap(metadata->arena, metadata->arenaSize);
+            for (int id = 0; id < metadata->numFileIds; id++)
+                closeFile(metadata, id);
+            free(metadata->files);
+            pthread_rwlock_destroy(&(metadata->filesLatch));
+            pthread_mutex_destroy(&(metadata->resizeLatch));
+            free(metadata);
+            return RC_OK;
+        }
+
         // "It is an error to shutdown a buffer pool that has pinned pages."
-        for (int i = 0; i < bm->numPages; i++)
+        for (int i = 0; i < metadata->numFrames; i++)
         {
-            if (pageFrames[i].fixCount > 0) return RC_WRITE_FAILED;
+            if (fixCountOf(metadata, i) > 0) return RC_WRITE_FAILED;
+        }
+        if (metadata->owner == metadata)
+        {
+            stopPrefetchers(metadata);
+            stopBackgroundWriter(metadata);
         }
         forceFlushPool(bm);
-        for (int i = 0; i < bm->numPages; i++)
+        for (int i = 0; i < metadata->numFrames; i++)
+        {
+            if (metadata->concurrent)
+                pthread_mutex_destroy(&(pageFrames[i].latch));
+        }
+
+        // partitions leave the page files and the frame arena to their pool
+        if (metadata->owner == metadata)
+        {
+            munmap(metadata->arena, metadata->arenaSize);
+            for (int id = 0; id < metadata->numFileIds; id++)
+                closeFile(metadata, id);
+            free(metadata->files);
+            pthread_rwlock_destroy(&(metadata->filesLatch));
+            pthread_mutex_destroy(&(metadata->resizeLatch));
+        }
+
+        // free the LRU-K bookkeeping
+        if (bm->strategy == RS_LRU_K)
+        {
+            freeHashTable(&(metadata->ghostTable));
+            free(metadata->history);
+            free(metadata->heap);
+            free(metadata->ghostPages);
+            free(metadata->ghostHistory);
+        }
+
+        // free the ARC bookkeeping
+        if (bm->strategy == RS_ARC)
         {
-            // free each page frame's data
-            free(pageFrames[i].data);
+            freeHashTable(&(metadata->ghostTable));
+            free(metadata->ghostPages);
+            free(metadata->ghostPrev);
+            free(metadata->ghostNext);
+            free(metadata->ghostList);
+        }
+
+        if (metadata->admission)
+            freeSketch(&(metadata->sketch));
+
+        if (metadata->concurrent)
+        {
+            pthread_mutex_destroy(&(metadata->tableLatch));
+            pthread_mutex_destroy(&(metadata->policyLatch));
+            pthread_mutex_destroy(&(metadata->readLatch));
+            pthread_cond_destroy(&(metadata->readDone));
         }
-        closePageFile(&(metadata->pageFile));
 
         // free the pageFrames array and metadata
         freeHashTable(pageTabe);
         free(pageFrames);
+        free(metadata->fixCounts);
+        free(metadata->refBits);
         free(metadata);
         return RC_OK;
     }
@@ -132,21 +831,180 @@ RC forceFlushPool(BM_BufferPool *const bm)
     if (bm->mgmtData != NULL) 
     {
         BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
-        BM_PageFrame *pageFrames = metadata->pageFrames;
-        for (int i = 0; i < bm->numPages; i++)
+        latchFiles(metadata);
+        RC result = flushPool(bm, ALL_FILES);
+        unlatchFiles(metadata);
+        return result;
+    }
+    else return RC_FILE_HANDLE_NOT_INIT;
+}
+
+RC flushPool(BM_BufferPool *const bm, int fileId)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+    // collect the occupied, dirty, and unpinned frames of the pool or of all its partitions
+    int numFrames = metadata->numFrames;
+    for (int p = 0; p < metadata->numPartitions; p++)
+        numFrames += ((BM_Metadata *)metadata->partitions[p].mgmtData)->numFrames;
+    BM_FrameRef *refs = malloc(numFrames * sizeof(BM_FrameRef));
+    int numRefs = 0;
+    for (int p = 0; p < metadata->numPartitions; p++)
+        numRefs += getFlushFrames(&(metadata->partitions[p]), refs + numRefs, fileId);
+    if (metadata->partitions == NULL)
+        numRefs = getFlushFrames(bm, refs, fileId);
+
+    // write them to disk in file order and unpin them again
+    qsort(refs, numRefs, sizeof(BM_FrameRef), compareFrameRefs);
+    RC result = flushFrames(metadata->owner, refs, numRefs);
+    for (int i = 0; i < numRefs; i++)
+        releaseFrame(refs[i].pool, refs[i].frame);
+
+    free(refs);
+    return result;
+}
+
+RC resizeBufferPool(BM_BufferPool *const bm, const int numPages)
+{
+    // make sure the metadata was successfully initialized
+    if (bm->mgmtData != NULL) 
+    {
+        BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+        // every partition keeps at least one frame, and none grows past the frames it reserved
+        int numPools = (metadata->partitions != NULL) ? metadata->numPartitions : 1;
+        int maxPages = metadata->maxFrames;
+        for (int p = 0; p < metadata->numPartitions; p++)
+            maxPages += ((BM_Metadata *)metadata->partitions[p].mgmtData)->maxFrames;
+        if (numPages < numPools || numPages > maxPages)
+            return RC_INVALID_STRATEGY_DATA;
+
+        RC result = RC_OK;
+        pthread_mutex_lock(&(metadata->resizeLatch));
+        latchFiles(metadata);
+        if (metadata->partitions == NULL)
+        {
+            if (numPages < bm->numPages)
+                result = shrinkPool(bm, numPages);
+            else growPool(bm, numPages);
+        }
+        else
+        {
+            // the partitions that shrink go first, if one of them has pinned frames the 
+            // partitions shrunk before it grow back and the others keep their size
+            int oldNumPages = bm->numPages;
+            for (int p = 0; p < numPools && result == RC_OK; p++)
+            {
+                int partitionPages = numPages / numPools + (p < numPages % numPools);
+                if (partitionPages < metadata->partitions[p].numPages)
+                    result = shrinkPool(&(metadata->partitions[p]), partitionPages);
+            }
+            int newNumPages = (result == RC_OK) ? numPages : oldNumPages;
+            for (int p = 0; p < numPools; p++)
+            {
+                int partitionPages = newNumPages / numPools + (p < newNumPages % numPools);
+                if (partitionPages > metadata->partitions[p].numPages)
+                    growPool(&(metadata->partitions[p]), partitionPages);
+            }
+            __atomic_store_n(&(bm->numPages), newNumPages, __ATOMIC_RELAXED);
+            __atomic_store_n(&(metadata->poolHandle.numPages), newNumPages, __ATOMIC_RELAXED);
+        }
+        unlatchFiles(metadata);
+        pthread_mutex_unlock(&(metadata->resizeLatch));
+        return result;
+    }
+    else return RC_FILE_HANDLE_NOT_INIT;
+}
+
+/* Buffer Manager Interface Page Files */
+
+RC registerPageFile(BM_BufferPool *const bm, const char *const pageFileName, int *fileId)
+{
+    // make sure the metadata was successfully initialized
+    if (bm->mgmtData != NULL) 
+    {
+        BM_Metadata *owner = ((BM_Metadata *)bm->mgmtData)->owner;
+        RC result = RC_OK;
+        pthread_rwlock_wrlock(&(owner->filesLatch));
+
+        // a file that is already open is registered once more under the same id
+        *fileId = NO_PAGE;
+        for (int id = 0; id < owner->numFileIds && *fileId == NO_PAGE; id++)
         {
-            // write the occupied, dirty, and unpinned pages to disk
-            if (pageFrames[i].occupied && pageFrames[i].dirty && pageFrames[i].fixCount == 0)
+            if (owner->files[id] != NULL && strcmp(owner->files[id]->fileName, pageFileName) == 0)
             {
-                writeBlock(pageFrames[i].pageNum, &(metadata->pageFile), pageFrames[i].data);
-                metadata->numWrite++;
-                pageFrames[i].timeStamp = getTimeStamp(metadata);
+                owner->files[id]->numRegistrations++;
+                *fileId = id;
+            }
+        }
 
-                // clear the dirty bool
-                pageFrames[i].dirty = false;
+        // otherwise it gets an id that was never used, or one of an unregistered file whose
+        // pages have all left the pool
+        for (int id = 1; id < MAX_POOL_FILES && *fileId == NO_PAGE; id++)
+        {
+            if (id >= owner->numFileIds || (owner->files[id] == NULL && !fileCached(owner, id, false)))
+            {
+                result = openFile(owner, id, pageFileName);
+                if (result == RC_OK && id >= owner->numFileIds)
+                    owner->numFileIds = id + 1;
+                if (result == RC_OK)
+                    *fileId = id;
+                else break;
             }
         }
-        return RC_OK;
+        if (*fileId == NO_PAGE && result == RC_OK)
+            result = RC_WRITE_FAILED;
+
+        pthread_rwlock_unlock(&(owner->filesLatch));
+        return result;
+    }
+    else return RC_FILE_HANDLE_NOT_INIT;
+}
+
+RC unregisterPageFile(BM_BufferPool *const bm, const int fileId)
+{
+    // make sure the metadata was successfully initialized, the pool's own file stays (only
+    // the registrations made with registerPageFile are dropped from it)
+    if (bm->mgmtData != NULL) 
+    {
+        BM_Metadata *owner = ((BM_Metadata *)bm->mgmtData)->owner;
+        RC result = RC_OK;
+        pthread_rwlock_wrlock(&(owner->filesLatch));
+        if (fileId < 0 || fileId >= owner->numFileIds || owner->files[fileId] == NULL)
+            result = RC_FILE_HANDLE_NOT_INIT;
+        else if (owner->files[fileId]->numRegistrations > 1)
+            owner->files[fileId]->numRegistrations--;
+        else if (fileId == 0)
+            result = RC_FILE_HANDLE_NOT_INIT;
+
+        // it is an error to unregister a file that has pinned pages, the dirty ones are 
+        // written before the file is closed (its clean pages leave the pool as usual)
+        else if (fileCached(owner, fileId, true))
+            result = RC_WRITE_FAILED;
+        else
+        {
+            result = flushPool(bm, fileId);
+            if (result == RC_OK)
+                closeFile(owner, fileId);
+        }
+        pthread_rwlock_unlock(&(owner->filesLatch));
+        return result;
+    }
+    else return RC_FILE_HANDLE_NOT_INIT;
+}
+
+RC forceFlushFile(BM_BufferPool *const bm, const int fileId)
+{
+    // make sure the metadata was successfully initialized
+    if (bm->mgmtData != NULL) 
+    {
+        BM_Metadata *owner = ((BM_Metadata *)bm->mgmtData)->owner;
+        RC result = RC_FILE_HANDLE_NOT_INIT;
+        latchFiles(owner);
+        if (fileId >= 0 && fileId < owner->numFileIds && owner->files[fileId] != NULL)
+            result = flushPool(bm, fileId);
+        unlatchFiles(owner);
+        return result;
     }
     else return RC_FILE_HANDLE_NOT_INIT;
 }
@@ -159,17 +1017,27 @@ RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page)
     if (bm->mgmtData != NULL) 
     {
         BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+        // the pages of a mapped pool are read-only
+        if (metadata->owner->mapped)
+            return RC_WRITE_FAILED;
         BM_PageFrame *pageFrames = metadata->pageFrames;
         HT_TableHandle *pageTabe = &(metadata->pageTable);
         int frameIndex;
 
-        // get the mapped frameIndex from pageNum
+        // a partitioned pool hands the page to its partition
+        if (metadata->partitions != NULL)
+            return markDirty(getPartition(bm, page->pageNum), page);
+
+        // get the mapped frameIndex from pageNum (the page is pinned, so it stays mapped)
         if (getValue(pageTabe, page->pageNum, &frameIndex) == 0)
         {
-            pageFrames[frameIndex].timeStamp = getTimeStamp(metadata);
-
             // set dirty bool
-            pageFrames[frameIndex].dirty = true;
+            setDirty(metadata, &(pageFrames[frameIndex]));
+
+            latchPolicy(metadata);
+            accessFrame(bm, &(pageFrames[frameIndex]));
+            unlatchPolicy(metadata);
             return RC_OK;
         }
         else return RC_IM_KEY_NOT_FOUND;
@@ -187,15 +1055,23 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page)
         HT_TableHandle *pageTabe = &(metadata->pageTable);
         int frameIndex;
 
-        // get the mapped frameIndex from pageNum
+        // a partitioned pool hands the page to its partition
+        if (metadata->partitions != NULL)
+            return unpinPage(getPartition(bm, page->pageNum), page);
+
+        // get the mapped frameIndex from pageNum (the page is pinned, so it stays mapped)
         if (getValue(pageTabe, page->pageNum, &frameIndex) == 0)
         {
-            pageFrames[frameIndex].timeStamp = getTimeStamp(metadata);
-
             // decrement (not below 0)
-            pageFrames[frameIndex].fixCount--;
-            if (pageFrames[frameIndex].fixCount < 0)
-                pageFrames[frameIndex].fixCount = 0;
+            int fixCount = __atomic_load_n(&(metadata->fixCounts[frameIndex]), __ATOMIC_RELAXED);
+            while (fixCount > 0 && !__atomic_compare_exchange_n(&(metadata->fixCounts[frameIndex]), 
+                    &fixCount, fixCount - 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+            // the frame may be reused as soon as it is unpinned, accessFrame looks at its
+            // current fixCount
+            latchPolicy(metadata);
+            accessFrame(bm, &(pageFrames[frameIndex]));
+            unlatchPolicy(metadata);
             return RC_OK;
         }
         else return RC_IM_KEY_NOT_FOUND;
@@ -209,26 +1085,44 @@ RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page)
     if (bm->mgmtData != NULL) 
     {
         BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+        // the pages of a mapped pool are read-only
+        if (metadata->owner->mapped)
+            return RC_WRITE_FAILED;
         BM_PageFrame *pageFrames = metadata->pageFrames;
         HT_TableHandle *pageTabe = &(metadata->pageTable);
         int frameIndex;
 
-        // get the mapped frameIndex from pageNum
+        // a partitioned pool hands the page to its partition
+        if (metadata->partitions != NULL)
+            return forcePage(getPartition(bm, page->pageNum), page);
+
+        // get the mapped frameIndex from pageNum (the frame latch makes sure it still holds 
+        // the page before it is written, and the files latch that its file stays open)
         if (getValue(pageTabe, page->pageNum, &frameIndex) == 0)
         {
-            pageFrames[frameIndex].timeStamp = getTimeStamp(metadata);
+            BM_PageFrame *frame = &(pageFrames[frameIndex]);
+            RC result = RC_WRITE_FAILED;
 
-            // only force the page if it is not pinned
-            if (pageFrames[frameIndex].fixCount == 0)
-            {
-                writeBlock(page->pageNum, &(metadata->pageFile), pageFrames[frameIndex].data);
-                metadata->numWrite++;
+            latchPolicy(metadata);
+            accessFrame(bm, frame);
+            unlatchPolicy(metadata);
 
-                // clear dirty bool
-                pageFrames[frameIndex].dirty = false;
-                return RC_OK;
+            // only force the page if it is not pinned (and still in the frame)
+            latchFiles(metadata);
+            latchFrame(metadata, frame);
+            if (fixCountOf(metadata, frameIndex) == 0 && frame->occupied && frame->pageNum == page->pageNum
+                    && fileOf(metadata->owner, frame->pageNum) != NULL)
+            {
+                // clear dirty bool, the page stays dirty if it fails to be written
+                bool dirty = clearDirty(metadata, frame);
+                result = writeFrame(metadata, frame);
+                if (result != RC_OK && dirty)
+                    setDirty(metadata, frame);
             }
-            else return RC_WRITE_FAILED;
+            unlatchFrame(metadata, frame);
+            unlatchFiles(metadata);
+            return result;
         }
         else return RC_IM_KEY_NOT_FOUND;
     }
@@ -240,87 +1134,211 @@ RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber
     if (bm->mgmtData != NULL) 
     {
         BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
-        BM_PageFrame *pageFrames = metadata->pageFrames;
-        HT_TableHandle *pageTabe = &(metadata->pageTable);
-        int frameIndex;
 
-        // make sure the pageNum is not negative
-        if (pageNum >= 0) 
-        {
-            // check if page is already in a frame and get the mapped frameIndex from pageNum
-            if (getValue(pageTabe, pageNum, &frameIndex) == 0)
-            {
-                pageFrames[frameIndex].timeStamp = getTimeStamp(metadata);
-                pageFrames[frameIndex].fixCount++;
-                page->data = pageFrames[frameIndex].data;
-                page->pageNum = pageNum;
-                return RC_OK;
-            }
-            else 
-            {
-                // use specified replacement strategy
-                BM_PageFrame *pageFrame;
-                if (bm->strategy == RS_FIFO)
-                    pageFrame = replacementFIFO(bm);
-                else // if (bm->strategy == RS_LRU)
-                    pageFrame = replacementLRU(bm);
-
-                // if the strategy failed (i.e. all frames are pinned) return error
-                if (pageFrame == NULL)
-                    return RC_WRITE_FAILED;
-                else 
-                {
-                    // set the mapping from pageNum to frameIndex
-                    setValue(pageTabe, pageNum, pageFrame->frameIndex);
-
-                    // grow the file if needed
-                    ensureCapacity(pageNum + 1, &(metadata->pageFile));
-
-                    // read data from disk
-                    readBlock(pageNum, &(metadata->pageFile), pageFrame->data);
-                    metadata->numRead++;
-
-                    // set frame's metadata
-                    pageFrame->dirty = false;
-                    pageFrame->fixCount = 1;
-                    pageFrame->occupied = true;
-                    pageFrame->pageNum = pageNum;
-                    page->data = pageFrame->data;
-                    page->pageNum = pageNum;
-                    return RC_OK;
-                }
-            }
-        }
-        else return RC_IM_KEY_NOT_FOUND;
+        // a partitioned pool hands the page to its partition
+        if (metadata->partitions != NULL)
+            return pinPage(getPartition(bm, pageNum), page, pageNum);
+
+        // make sure the pageNum is not negative and its file is registered
+        RC result = checkFile(metadata, pageNum);
+        if (result != RC_OK) 
+            return result;
+
+        // check if page is already in a frame, otherwise load it (its file stays open while 
+        // it is read, and a mapped pool must not have to grow the file)
+        if (pinResident(bm, page, pageNum) == RC_OK)
+            return RC_OK;
+        latchFiles(metadata);
+        result = checkPage(metadata, pageNum);
+        if (result == RC_OK)
+            result = loadPage(bm, page, pageNum);
+        unlatchFiles(metadata);
+        return result;
     }
     else return RC_FILE_HANDLE_NOT_INIT;
 }
 
-/* Statistics Interface */
-
-PageNumber *getFrameContents (BM_BufferPool *const bm)
+RC pinPages (BM_BufferPool *const bm, const PageNumber *pageNums, BM_PageHandle *handles, const int n)
 {
-    // make sure the metadata was successfully initialized
     if (bm->mgmtData != NULL) 
     {
         BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
-        BM_PageFrame *pageFrames = metadata->pageFrames;
+        RC result = RC_OK;
 
-        // the user will be responsible for calling free
-        PageNumber *array = (PageNumber *)malloc(sizeof(PageNumber) * bm->numPages);
-        for (int i = 0; i < bm->numPages; i++)
+        // make sure no pageNum is negative (or of an unregistered file, or past the end of a 
+        // mapped file) before pinning anything, the files stay open until the pages are read
+        latchFiles(metadata);
+        for (int i = 0; i < n; i++)
         {
-            if (pageFrames[i].occupied)
-                array[i] = pageFrames[i].pageNum;
-            else array[i] = NO_PAGE;
+            RC check = checkPage(metadata, pageNums[i]);
+            if (check != RC_OK)
+            {
+                unlatchFiles(metadata);
+                return check;
+            }
+        }
+        if (n <= 0)
+        {
+            unlatchFiles(metadata);
+            return RC_OK;
         }
-        return array;
-    }
-    else return NULL;
-}
 
-bool *getDirtyFlags (BM_BufferPool *const bm)
-{
+        BM_FrameRef *reads = malloc(n * sizeof(BM_FrameRef));
+        BM_FrameRef *resident = malloc(n * sizeof(BM_FrameRef));
+        bool *pinned = calloc(n, sizeof(bool));
+        int numReads = 0;
+        int numResident = 0;
+
+        // pin the hits first, a partitioned pool hands each page to its partition
+        for (int i = 0; i < n; i++)
+        {
+            BM_BufferPool *pool = (metadata->partitions != NULL) ? getPartition(bm, pageNums[i]) : bm;
+            pinned[i] = (pinResident(pool, &(handles[i]), pageNums[i]) == RC_OK);
+        }
+
+        // then map every miss to a victim frame
+        for (int i = 0; i < n; i++)
+        {
+            if (pinned[i])
+                continue;
+
+            BM_BufferPool *pool = (metadata->partitions != NULL) ? getPartition(bm, pageNums[i]) : bm;
+            BM_Metadata *poolData = (BM_Metadata *)pool->mgmtData;
+            BM_PageFrame *pageFrame;
+
+            // TinyLFU counts every request, hits included
+            if (poolData->admission)
+            {
+                latchPolicy(poolData);
+                incrementFrequency(&(poolData->sketch), pageNums[i]);
+                unlatchPolicy(poolData);
+            }
+
+            int reserved = reserveFrame(pool, pageNums[i], &pageFrame);
+            if (reserved == RESERVE_FULL || reserved == RESERVE_WRITE_FAILED)
+            {
+                result = RC_WRITE_FAILED;
+                break;
+            }
+
+            // a page that got loaded meanwhile (or is repeated in pageNums) is pinned once our 
+            // own reads are done, waiting for it before could wait for a read we have not issued
+            BM_FrameRef ref = {pool, pageFrame, i, RC_OK};
+            if (reserved == RESERVE_RESIDENT)
+                resident[numResident++] = ref;
+            else reads[numReads++] = ref;
+            pinned[i] = true;
+        }
+
+        // read the reserved frames in file order, the frames whose read failed are unmapped 
+        // and unpinned again
+        qsort(reads, numReads, sizeof(BM_FrameRef), compareFrameRefs);
+        readFrames(reads, numReads);
+        for (int i = 0; i < numReads; i++)
+        {
+            if (reads[i].result != RC_OK)
+            {
+                failRead(reads[i].pool, reads[i].frame);
+                pinned[reads[i].index] = false;
+                result = reads[i].result;
+                continue;
+            }
+            finishRead((BM_Metadata *)reads[i].pool->mgmtData, reads[i].frame);
+            handles[reads[i].index].data = reads[i].frame->data;
+            handles[reads[i].index].pageNum = reads[i].frame->pageNum;
+        }
+        for (int i = 0; i < numResident; i++)
+        {
+            RC pinResult = pinFrame(resident[i].pool, &(handles[resident[i].index]), resident[i].frame, true);
+            if (pinResult != RC_OK)
+            {
+                pinned[resident[i].index] = false;
+                result = pinResult;
+            }
+        }
+
+        // if the pool ran out of frames or a read failed drop the pages pinned so far
+        if (result != RC_OK)
+        {
+            for (int i = 0; i < n; i++)
+                if (pinned[i])
+                    unpinPage(bm, &(handles[i]));
+        }
+        unlatchFiles(metadata);
+
+        free(reads);
+        free(resident);
+        free(pinned);
+        return result;
+    }
+    else return RC_FILE_HANDLE_NOT_INIT;
+}
+
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber *pages, const int count)
+{
+    if (bm->mgmtData != NULL) 
+    {
+        BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+        RC result = RC_OK;
+        latchFiles(metadata);
+        for (int i = 0; i < count && result == RC_OK; i++)
+        {
+            // make sure the pageNum is not negative (or of an unregistered file, or past the 
+            // end of a mapped file)
+            result = checkPage(metadata, pages[i]);
+            if (result != RC_OK)
+                break;
+
+            // a partitioned pool hands each page to its partition, the prefetch threads use
+            // the pool's own copy of the handle
+            BM_BufferPool *pool = (metadata->partitions != NULL) ? getPartition(bm, pages[i]) : &(metadata->poolHandle);
+            result = prefetchPage(pool, pages[i]);
+        }
+        unlatchFiles(metadata);
+        return result;
+    }
+    else return RC_FILE_HANDLE_NOT_INIT;
+}
+
+/* Statistics Interface */
+
+PageNumber *getFrameContents (BM_BufferPool *const bm)
+{
+    // make sure the metadata was successfully initialized
+    if (bm->mgmtData != NULL) 
+    {
+        BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+        BM_PageFrame *pageFrames = metadata->pageFrames;
+
+        // the user will be responsible for calling free
+        PageNumber *array = (PageNumber *)malloc(sizeof(PageNumber) * bm->numPages);
+
+        // a partitioned pool lists the frames of its partitions one after another
+        if (metadata->partitions != NULL)
+        {
+            int offset = 0;
+            for (int p = 0; p < metadata->numPartitions; p++)
+            {
+                PageNumber *partition = getFrameContents(&(metadata->partitions[p]));
+                memcpy(&(array[offset]), partition, sizeof(PageNumber) * metadata->partitions[p].numPages);
+                offset += metadata->partitions[p].numPages;
+                free(partition);
+            }
+            return array;
+        }
+        for (int i = 0; i < bm->numPages; i++)
+        {
+            if (pageFrames[i].occupied)
+                array[i] = pageFrames[i].pageNum;
+            else array[i] = NO_PAGE;
+        }
+        return array;
+    }
+    else return NULL;
+}
+
+bool *getDirtyFlags (BM_BufferPool *const bm)
+{
     // make sure the metadata was successfully initialized
     if (bm->mgmtData != NULL) 
     {
@@ -329,10 +1347,24 @@ bool *getDirtyFlags (BM_BufferPool *const bm)
 
         // the user will be responsible for calling free
         bool *array = (bool *)malloc(sizeof(bool) * bm->numPages);
+
+        // a partitioned pool lists the frames of its partitions one after another
+        if (metadata->partitions != NULL)
+        {
+            int offset = 0;
+            for (int p = 0; p < metadata->numPartitions; p++)
+            {
+                bool *partition = getDirtyFlags(&(metadata->partitions[p]));
+                memcpy(&(array[offset]), partition, sizeof(bool) * metadata->partitions[p].numPages);
+                offset += metadata->partitions[p].numPages;
+                free(partition);
+            }
+            return array;
+        }
         for (int i = 0; i < bm->numPages; i++)
         {
             if (pageFrames[i].occupied)
-                array[i] = pageFrames[i].dirty;
+                array[i] = __atomic_load_n(&(pageFrames[i].dirty), __ATOMIC_RELAXED);
             else array[i] = false;
         }
         return array;
@@ -350,10 +1382,24 @@ int *getFixCounts (BM_BufferPool *const bm)
 
         // the user will be responsible for calling free
         int *array = (int *)malloc(sizeof(int) * bm->numPages);
+
+        // a partitioned pool lists the frames of its partitions one after another
+        if (metadata->partitions != NULL)
+        {
+            int offset = 0;
+            for (int p = 0; p < metadata->numPartitions; p++)
+            {
+                int *partition = getFixCounts(&(metadata->partitions[p]));
+                memcpy(&(array[offset]), partition, sizeof(int) * metadata->partitions[p].numPages);
+                offset += metadata->partitions[p].numPages;
+                free(partition);
+            }
+            return array;
+        }
         for (int i = 0; i < bm->numPages; i++)
         {
             if (pageFrames[i].occupied)
-                array[i] = pageFrames[i].fixCount;
+                array[i] = fixCountOf(metadata, i);
             else array[i] = 0;
         }
         return array;
@@ -361,109 +1407,2395 @@ int *getFixCounts (BM_BufferPool *const bm)
     else return NULL;
 }
 
-int getNumReadIO (BM_BufferPool *const bm)
+long long getNumReadIO (BM_BufferPool *const bm)
 {
     // make sure the metadata was successfully initialized
     if (bm->mgmtData != NULL) 
     {
         BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
-        return metadata->numRead;
+        long long total = __atomic_load_n(&(metadata->numRead), __ATOMIC_RELAXED);
+
+        // a partitioned pool counts the I/Os of its partitions
+        for (int p = 0; p < metadata->numPartitions; p++)
+            total += getNumReadIO(&(metadata->partitions[p]));
+        return total;
     }
     else return 0;
 }
 
-int getNumWriteIO (BM_BufferPool *const bm)
+long long getNumWriteIO (BM_BufferPool *const bm)
 {
     // make sure the metadata was successfully initialized
     if (bm->mgmtData != NULL) 
     {
         BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
-        return metadata->numWrite;
+        long long total = __atomic_load_n(&(metadata->numWrite), __ATOMIC_RELAXED);
+
+        // a partitioned pool counts the I/Os of its partitions
+        for (int p = 0; p < metadata->numPartitions; p++)
+            total += getNumWriteIO(&(metadata->partitions[p]));
+        return total;
     }
     else return 0;
 }
 
+int getPageSize (BM_BufferPool *const bm)
+{
+    // make sure the metadata was successfully initialized
+    if (bm->mgmtData != NULL) 
+        return ((BM_Metadata *)bm->mgmtData)->owner->files[0]->pageFile.pageSize;
+    else return 0;
+}
+
 /* Replacement Policies */
 
 BM_PageFrame *replacementFIFO(BM_BufferPool *const bm)
 {
     BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
-    BM_PageFrame *pageFrames = metadata->pageFrames;
-
     int firstIndex = metadata->queueIndex;
-    int currentIndex = metadata->queueIndex;
 
-    // keep cycling in FIFO order until a frame is found that is not pinned
-    do 
+    // cycle in FIFO order from the frame after the last victim until a frame is found that
+    // is not pinned, i.e. search up to the end of the frames and then from the start
+    int victim = findUnpinned(metadata, firstIndex + 1, bm->numPages);
+    if (victim == NO_FRAME)
+        victim = findUnpinned(metadata, 0, firstIndex + 1);
+
+    // all frames are pinned
+    if (victim == NO_FRAME)
+        return NULL;
+    return &(metadata->pageFrames[victim]);
+}
+
+BM_PageFrame *replacementLRU(BM_BufferPool *const bm)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+    // the first unpinned frame in the recency list is the victim
+    // if there is none, all frames are pinned and NULL is returned
+    int victim = listHead(metadata, &(metadata->lruHead), &(metadata->lruTail));
+    if (victim == NO_FRAME) 
+        return NULL;
+    else return &(metadata->pageFrames[victim]);
+}
+
+BM_PageFrame *replacementCLOCK(BM_BufferPool *const bm)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    int hand = metadata->clockHand;
+
+    // the hand stops at the first unpinned frame whose reference bit is clear (the 
+    // referenced, unpinned frames it passes get a second chance once it is committed)
+    int victim = findUnreferenced(metadata, hand, bm->numPages);
+    if (victim == NO_FRAME)
+        victim = findUnreferenced(metadata, 0, hand);
+    metadata->clockSwept = (victim == NO_FRAME);
+
+    if (victim == NO_FRAME)
     {
-        currentIndex = (currentIndex + 1) % bm->numPages;
-        if (pageFrames[currentIndex].fixCount == 0)
-            break;
+        // the first sweep would clear all bits, the second one stops at the first unpinned 
+        // frame
+        victim = findUnpinned(metadata, hand, bm->numPages);
+        if (victim == NO_FRAME)
+            victim = findUnpinned(metadata, 0, hand);
+
+        // all frames are pinned
+        if (victim == NO_FRAME)
+            return NULL;
     }
-    while (currentIndex != firstIndex);
+    return &(metadata->pageFrames[victim]);
+}
 
-    // put the index back into the metadata pointer
-    metadata->queueIndex = currentIndex;
+BM_PageFrame *replacementLRUK(BM_BufferPool *const bm)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
 
-    // ensure we did not cycle into a pinned frame (i.e. all frames are pinned) or return NULL
-    if (pageFrames[currentIndex].fixCount == 0)
-        return getAfterEviction(bm, currentIndex);
-    else return NULL;
+    // the heap holds the unpinned frames and its root has the largest backward k-distance,
+    // frames pinned by a hit that did not leave the heap yet are removed
+    while (metadata->heapSize > 0 && fixCountOf(metadata, metadata->heap[0]) > 0)
+        heapRemove(metadata, &(metadata->pageFrames[metadata->heap[0]]));
+
+    // if the heap is empty, all frames are pinned and NULL is returned
+    if (metadata->heapSize == 0)
+        return NULL;
+    else return &(metadata->pageFrames[metadata->heap[0]]);
 }
 
-BM_PageFrame *replacementLRU(BM_BufferPool *const bm)
+BM_PageFrame *replacementLFU(BM_BufferPool *const bm)
 {
     BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
-    BM_PageFrame *pageFrames = metadata->pageFrames;
 
-    TimeStamp min = UINT_MAX;
-    int minIndex = -1;
+    // the buckets hold the unpinned frames, the least recently used frame of the lowest 
+    // non-empty bucket is the victim
+    while (metadata->minFrequency <= LFU_MAX_FREQUENCY)
+    {
+        int frequency = metadata->minFrequency;
+        int victim = listHead(metadata, &(metadata->bucketHead[frequency]), &(metadata->bucketTail[frequency]));
+        if (victim != NO_FRAME)
+            return &(metadata->pageFrames[victim]);
+        metadata->minFrequency++;
+    }
+
+    // all frames are pinned
+    return NULL;
+}
 
-    // find unpinned frame with smallest timestamp
-    for (int i = 0; i < bm->numPages; i++)
+BM_PageFrame *replacementARC(BM_BufferPool *const bm, PageNumber pageNum)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    int list;
+
+    // the target size of T1 adapted to a ghost hit (committed with the victim)
+    int target = arcAdaptTarget(bm, pageNum, &list);
+
+    // use an empty frame while the pool is filling up
+    int victim = listHead(metadata, &(metadata->lruHead), &(metadata->lruTail));
+    if (victim != NO_FRAME)
+        return &(metadata->pageFrames[victim]);
+
+    // REPLACE: evict from T1 if it is above its target, else from T2, but take the other list 
+    // if all frames of the chosen one are pinned
+    int t1Victim = listHead(metadata, &(metadata->t1Head), &(metadata->t1Tail));
+    int t2Victim = listHead(metadata, &(metadata->t2Head), &(metadata->t2Tail));
+    bool fromT1 = metadata->t1Size >= 1 
+            && (metadata->t1Size > target || (list == ARC_T2 && metadata->t1Size == target));
+    victim = fromT1 ? t1Victim : t2Victim;
+    if (victim == NO_FRAME)
+        victim = fromT1 ? t2Victim : t1Victim;
+
+    // all frames are pinned
+    if (victim == NO_FRAME)
+        return NULL;
+    return &(metadata->pageFrames[victim]);
+}
+
+int arcAdaptTarget(BM_BufferPool *const bm, PageNumber pageNum, int *list)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    int capacity = bm->numPages;
+    int target = metadata->arcTarget;
+    int slot = NO_FRAME;
+
+    // grow the target on a hit in B1, shrink it on a hit in B2
+    *list = ARC_NONE;
+    if (getValue(&(metadata->ghostTable), pageNum, &slot) == 0)
     {
-        if (pageFrames[i].fixCount == 0 && pageFrames[i].timeStamp < min) 
+        *list = metadata->ghostList[slot];
+        if (*list == ARC_T1)
         {
-            min = pageFrames[i].timeStamp;
-            minIndex = i;
+            int delta = (metadata->b1Size >= metadata->b2Size) ? 1 : metadata->b2Size / metadata->b1Size;
+            target = (target + delta < capacity) ? target + delta : capacity;
+        }
+        else
+        {
+            int delta = (metadata->b2Size >= metadata->b1Size) ? 1 : metadata->b1Size / metadata->b2Size;
+            target = (target - delta > 0) ? target - delta : 0;
         }
     }
-    
-    // if all frames were pinned, return NULL
-    if (minIndex == -1) 
-        return NULL;
-    else return getAfterEviction(bm, minIndex);
+    return target;
+}
+
+void commitVictim(BM_BufferPool *const bm, PageNumber pageNum, BM_PageFrame *victim)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    int index = victim->frameIndex;
+
+    if (bm->strategy == RS_FIFO)
+    {
+        // the queue goes on after the victim
+        metadata->queueIndex = index;
+    }
+    else if (bm->strategy == RS_CLOCK)
+    {
+        // give the referenced, unpinned frames the hand passed a second chance, all of them 
+        // if it took a second sweep
+        int hand = metadata->clockHand;
+        if (metadata->clockSwept)
+            clearReferences(metadata, 0, bm->numPages);
+        else if (index >= hand)
+            clearReferences(metadata, hand, index);
+        else 
+        {
+            clearReferences(metadata, hand, bm->numPages);
+            clearReferences(metadata, 0, index);
+        }
+        metadata->clockHand = (index + 1) % bm->numPages;
+    }
+    else if (bm->strategy == RS_ARC)
+    {
+        int list;
+        metadata->arcTarget = arcAdaptTarget(bm, pageNum, &list);
+
+        // a new page must leave room in the ghost lists (an empty frame leaves them alone)
+        bool forget = false;
+        if (victim->occupied && list == ARC_NONE)
+        {
+            int capacity = bm->numPages;
+            if (metadata->t1Size + metadata->b1Size >= capacity)
+            {
+                // T1 and B1 are full, forget the oldest ghost in B1 or, without one, the victim
+                if (metadata->b1Size > 0)
+                    ghostDrop(metadata, metadata->b1Head);
+                else forget = true;
+            }
+            else if (metadata->t1Size + metadata->t2Size + metadata->b1Size + metadata->b2Size >= 2 * capacity)
+                ghostDrop(metadata, metadata->b2Head);
+        }
+        victim->arcForget = forget;
+    }
 }
 
 /* Helpers */
 
-TimeStamp getTimeStamp(BM_Metadata *metadata)
+void initPool(BM_BufferPool *const bm, BM_Metadata *metadata, const int numPages, const int maxPages,
+        ReplacementStrategy strategy, int k, int agingPeriod, const BM_PoolOptions *options, char *arena)
+{
+    // initialize the metadata
+    HT_TableHandle *pageTabe = &(metadata->pageTable);
+
+    // start the queue from the last element as it gets incremented by one and modded 
+    // at the start of each call of replacementFIFO
+    metadata->queueIndex = numPages - 1;
+    metadata->lruHead = NO_FRAME;
+    metadata->lruTail = NO_FRAME;
+    metadata->clockHand = 0;
+    metadata->clockSwept = false;
+    metadata->k = k;
+    metadata->timeStamp = 0;
+    metadata->heapSize = 0;
+    metadata->minFrequency = 0;
+    metadata->agingPeriod = agingPeriod;
+    metadata->agingCountdown = agingPeriod;
+    metadata->t1Head = metadata->t1Tail = NO_FRAME;
+    metadata->t2Head = metadata->t2Tail = NO_FRAME;
+    metadata->b1Head = metadata->b1Tail = NO_FRAME;
+    metadata->b2Head = metadata->b2Tail = NO_FRAME;
+    metadata->t1Size = metadata->t2Size = 0;
+    metadata->b1Size = metadata->b2Size = 0;
+    metadata->arcTarget = 0;
+    metadata->admission = options->admissionSketchBytes > 0;
+    metadata->maxFrames = maxPages;
+    metadata->numFrames = maxPages + (metadata->admission ? ADMISSION_SCRATCH_FRAMES : 0);
+    for (int i = 0; i <= LFU_MAX_FREQUENCY; i++)
+    {
+        metadata->bucketHead[i] = NO_FRAME;
+        metadata->bucketTail[i] = NO_FRAME;
+    }
+    metadata->numRead = 0;
+    metadata->numWrite = 0;
+    metadata->numDirty = 0;
+    metadata->highWatermark = options->dirtyHighWatermark;
+    metadata->lowWatermark = options->dirtyLowWatermark;
+    setWatermarks(metadata, numPages);
+    metadata->writerCleaning = false;
+
+    // hits on FIFO, CLOCK and LRU pools leave the replacement state alone (LRU only orders 
+    // unpinned frames), so in a concurrent pool only the others take the policy latch on a hit
+    metadata->latchHits = metadata->admission 
+            || (strategy != RS_FIFO && strategy != RS_CLOCK && strategy != RS_LRU);
+
+    // the page table maps at most one page per frame (of the largest pool), in a concurrent
+    // pool hits read it without latches
+    if (metadata->concurrent)
+        initConcurrentHashTable(pageTabe, metadata->numFrames);
+    else initHashTable(pageTabe, metadata->numFrames);
+    if (metadata->concurrent)
+    {
+        pthread_mutex_init(&(metadata->tableLatch), NULL);
+        pthread_mutex_init(&(metadata->policyLatch), NULL);
+        pthread_mutex_init(&(metadata->readLatch), NULL);
+        pthread_cond_init(&(metadata->readDone), NULL);
+    }
+    metadata->pageFrames = (BM_PageFrame *)malloc(sizeof(BM_PageFrame) * metadata->numFrames);
+    metadata->fixCounts = (int *)calloc(metadata->numFrames, sizeof(int));
+    metadata->refBits = (unsigned char *)calloc(metadata->numFrames, sizeof(unsigned char));
+    if (metadata->admission)
+        initSketch(&(metadata->sketch), options->admissionSketchBytes);
+    if (strategy == RS_LRU_K)
+    {
+        // keep the histories of as many evicted pages as there are frames
+        metadata->history = (TimeStamp *)calloc((size_t)maxPages * k, sizeof(TimeStamp));
+        metadata->heap = (int *)malloc(sizeof(int) * maxPages);
+        metadata->ghostPages = (PageNumber *)malloc(sizeof(PageNumber) * maxPages);
+        metadata->ghostHistory = (TimeStamp *)malloc(sizeof(TimeStamp) * (size_t)maxPages * k);
+        metadata->ghostCursor = 0;
+        initHashTable(&(metadata->ghostTable), maxPages);
+        for (int i = 0; i < maxPages; i++)
+            metadata->ghostPages[i] = NO_PAGE;
+    }
+    if (strategy == RS_ARC)
+    {
+        // B1 and B2 hold at most as many pages as there are frames, the extra slot covers
+        // the moment a victim is ghosted before the requested page leaves its ghost list
+        metadata->ghostPages = (PageNumber *)malloc(sizeof(PageNumber) * (maxPages + 1));
+        metadata->ghostPrev = (int *)malloc(sizeof(int) * (maxPages + 1));
+        metadata->ghostNext = (int *)malloc(sizeof(int) * (maxPages + 1));
+        metadata->ghostList = (int *)malloc(sizeof(int) * (maxPages + 1));
+        initHashTable(&(metadata->ghostTable), maxPages + 1);
+        for (int i = 0; i <= maxPages; i++)
+            metadata->ghostNext[i] = (i < maxPages) ? i + 1 : NO_FRAME;
+        metadata->ghostFree = 0;
+    }
+    for (int i = 0; i < maxPages; i++)
+    {
+        metadata->pageFrames[i].frameIndex = i;
+        metadata->pageFrames[i].data = arena + (size_t)i * metadata->owner->files[0]->pageFile.pageSize;
+        metadata->pageFrames[i].dirty = false;
+        metadata->pageFrames[i].occupied = false;
+        metadata->pageFrames[i].frequency = 0;
+        metadata->pageFrames[i].arcList = ARC_NONE;
+        metadata->pageFrames[i].arcForget = false;
+        metadata->pageFrames[i].state = FRAME_READY;
+        metadata->pageFrames[i].tablePage = NO_PAGE;
+        if (metadata->concurrent)
+            pthread_mutex_init(&(metadata->pageFrames[i].latch), NULL);
+
+        // empty frames start in the recency list (or the LFU bucket 0) in frame order, the 
+        // frames the pool can grow into are not linked
+        metadata->pageFrames[i].linked = false;
+        metadata->pageFrames[i].heapPos = NO_FRAME;
+        if (i >= numPages)
+            continue;
+        if (strategy == RS_LFU)
+            listAppend(metadata->pageFrames, &(metadata->bucketHead[0]), &(metadata->bucketTail[0]), &(metadata->pageFrames[i]));
+        else listAppend(metadata->pageFrames, &(metadata->lruHead), &(metadata->lruTail), &(metadata->pageFrames[i]));
+
+        // and as the first LRU-K victims (they have no references)
+        if (strategy == RS_LRU_K)
+            heapInsert(metadata, &(metadata->pageFrames[i]));
+    }
+    for (int i = maxPages; i < metadata->numFrames; i++)
+    {
+        // scratch frames are invisible to the replacement policies
+        metadata->pageFrames[i].frameIndex = i;
+        metadata->pageFrames[i].data = arena + (size_t)i * metadata->owner->files[0]->pageFile.pageSize;
+        metadata->pageFrames[i].dirty = false;
+        metadata->pageFrames[i].occupied = false;
+        metadata->pageFrames[i].linked = false;
+        metadata->pageFrames[i].heapPos = NO_FRAME;
+        metadata->pageFrames[i].state = FRAME_READY;
+        metadata->pageFrames[i].tablePage = NO_PAGE;
+        if (metadata->concurrent)
+            pthread_mutex_init(&(metadata->pageFrames[i].latch), NULL);
+    }
+    bm->mgmtData = (void *)metadata;
+    bm->numPages = numPages;
+    bm->pageFile = (char *)&(metadata->owner->files[0]->pageFile);
+    bm->strategy = strategy;
+}
+
+void setWatermarks(BM_Metadata *metadata, int numPages)
 {
-    // increment the global timestamp after returning it to be assigned to a frame
-    return metadata->timeStamp++;
+    // the pool may be in use while it is resized, and markDirty reads them without a latch
+    __atomic_store_n(&(metadata->dirtyHigh), (metadata->highWatermark * numPages + 99) / 100, __ATOMIC_RELAXED);
+    __atomic_store_n(&(metadata->dirtyLow), metadata->lowWatermark * numPages / 100, __ATOMIC_RELAXED);
 }
 
-BM_PageFrame *getAfterEviction(BM_BufferPool *const bm, int frameIndex)
+RC shrinkPool(BM_BufferPool *const bm, int numPages)
 {
     BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
     BM_PageFrame *pageFrames = metadata->pageFrames;
-    HT_TableHandle *pageTabe = &(metadata->pageTable);
+    int oldNumPages = bm->numPages;
+    int numReleased = oldNumPages - numPages;
+    bool *evicted = (bool *)calloc(numReleased, sizeof(bool));
+    int numEvicted = 0;
+
+    // a pool that is used by one thread fails at once if a frame past numPages is pinned,
+    // before anything is evicted
+    if (!metadata->concurrent)
+    {
+        for (int i = numPages; i < oldNumPages; i++)
+        {
+            if (fixCountOf(metadata, i) > 0)
+            {
+                free(evicted);
+                return RC_WRITE_FAILED;
+            }
+        }
+    }
+
+    // pins are short, so a concurrent pool keeps trying the frames that are pinned until
+    // SHRINK_TIMEOUT_MS passed
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long deadline = (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000 + SHRINK_TIMEOUT_MS;
+    while (true)
+    {
+        for (int i = 0; i < numReleased; i++)
+        {
+            BM_PageFrame *frame = &(pageFrames[numPages + i]);
+
+            // pinning the frame keeps misses from choosing it, then its dirty page is written
+            // (a page that fails to be written stays dirty and keeps its frame for now)
+            if (evicted[i] || !claimFrame(metadata, frame))
+                continue;
+            latchFrame(metadata, frame);
+            if (frame->occupied && clearDirty(metadata, frame) && writeFrame(metadata, frame) != RC_OK)
+                setDirty(metadata, frame);
+            unlatchFrame(metadata, frame);
+
+            // hits pin frames without a latch, so the page is unmapped for them before the fix 
+            // count is checked (see reserveFrame)
+            latchTable(metadata);
+            PageNumber oldPage = frame->tablePage;
+            __atomic_store_n(&(frame->tablePage), NO_PAGE, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&(metadata->fixCounts[frame->frameIndex]), __ATOMIC_SEQ_CST) != 1 
+                    || __atomic_load_n(&(frame->dirty), __ATOMIC_SEQ_CST))
+            {
+                __atomic_store_n(&(frame->tablePage), oldPage, __ATOMIC_SEQ_CST);
+                unlatchTable(metadata);
+                releaseFrame(bm, frame);
+                continue;
+            }
+
+            // evict the page and take the frame out of the replacement state, it stays pinned
+            // so nothing uses it until the pool shrank
+            latchPolicy(metadata);
+            detachFrame(bm, frame);
+            if (frame->occupied)
+            {
+                removePair(&(metadata->pageTable), frame->pageNum);
+                retireFrame(bm, frame);
+            }
+            frame->occupied = false;
+            unlatchPolicy(metadata);
+            unlatchTable(metadata);
+            evicted[i] = true;
+            numEvicted++;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (numEvicted == numReleased || !metadata->concurrent 
+                || (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000 >= deadline)
+            break;
+        struct timespec pollInterval = {0, SHRINK_POLL_MS * 1000000L};
+        nanosleep(&pollInterval, NULL);
+    }
+
+    bool released = numEvicted == numReleased;
+    latchTable(metadata);
+    latchPolicy(metadata);
+    if (released)
+    {
+        __atomic_store_n(&(bm->numPages), numPages, __ATOMIC_RELAXED);
+        __atomic_store_n(&(metadata->poolHandle.numPages), numPages, __ATOMIC_RELAXED);
+
+        // FIFO and CLOCK continue within the frames that are left, and the ghosts that no 
+        // longer fit are forgotten
+        if (metadata->queueIndex >= numPages)
+            metadata->queueIndex = numPages - 1;
+        if (metadata->clockHand >= numPages)
+            metadata->clockHand = 0;
+        if (bm->strategy == RS_LRU_K)
+        {
+            for (int slot = numPages; slot < oldNumPages; slot++)
+            {
+                if (metadata->ghostPages[slot] != NO_PAGE)
+                    removePair(&(metadata->ghostTable), metadata->ghostPages[slot]);
+                metadata->ghostPages[slot] = NO_PAGE;
+            }
+            if (metadata->ghostCursor >= numPages)
+                metadata->ghostCursor = 0;
+        }
+        if (bm->strategy == RS_ARC)
+        {
+            if (metadata->arcTarget > numPages)
+                metadata->arcTarget = numPages;
+            while (metadata->b1Size > 0 && metadata->t1Size + metadata->b1Size > numPages)
+                ghostDrop(metadata, metadata->b1Head);
+            while (metadata->b2Size > 0 && metadata->t1Size + metadata->t2Size + metadata->b1Size + metadata->b2Size > 2 * numPages)
+                ghostDrop(metadata, metadata->b2Head);
+        }
+        setWatermarks(metadata, numPages);
+    }
+    else
+    {
+        // a frame stayed pinned, so the pool keeps its size and the frames evicted so far
+        // become empty frames again
+        for (int i = 0; i < numReleased; i++)
+        {
+            if (evicted[i])
+                attachFrame(bm, &(pageFrames[numPages + i]));
+        }
+    }
+
+    // drop the pins before the policy latch, so no miss sees an empty frame pinned (frames 
+    // that left the pool are no longer known to the replacement policy)
+    for (int i = 0; i < numReleased; i++)
+    {
+        if (evicted[i])
+            __atomic_sub_fetch(&(metadata->fixCounts[numPages + i]), 1, __ATOMIC_ACQ_REL);
+    }
+    unlatchPolicy(metadata);
+    unlatchTable(metadata);
+
+    // give the memory of the released frames back to the system, the arena maps it again
+    // (zeroed) once a frame is used after the pool grows (frames of a mapped pool point into
+    // the mappings and have none)
+    if (released && !metadata->owner->mapped)
+        madvise(pageFrames[numPages].data, (size_t)numReleased * metadata->owner->files[0]->pageFile.pageSize, MADV_DONTNEED);
+
+    free(evicted);
+    return released ? RC_OK : RC_WRITE_FAILED;
+}
+
+void growPool(BM_BufferPool *const bm, int numPages)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    int oldNumPages = bm->numPages;
+
+    latchPolicy(metadata);
+    __atomic_store_n(&(bm->numPages), numPages, __ATOMIC_RELAXED);
+    __atomic_store_n(&(metadata->poolHandle.numPages), numPages, __ATOMIC_RELAXED);
+
+    // the new frames are empty, so they are the next victims in frame order (FIFO and CLOCK
+    // continue with them as well)
+    for (int i = numPages - 1; i >= oldNumPages; i--)
+        attachFrame(bm, &(metadata->pageFrames[i]));
+    metadata->queueIndex = oldNumPages - 1;
+    metadata->clockHand = oldNumPages;
+    setWatermarks(metadata, numPages);
+    unlatchPolicy(metadata);
+}
+
+void detachFrame(BM_BufferPool *const bm, BM_PageFrame *frame)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+    // the frame is pinned, but pins leave frames linked until a replacement policy passes them
+    if (frame->heapPos != NO_FRAME)
+        heapRemove(metadata, frame);
+    if (frame->linked)
+    {
+        int *head = &(metadata->lruHead);
+        int *tail = &(metadata->lruTail);
+        if (bm->strategy == RS_LFU)
+        {
+            head = &(metadata->bucketHead[frame->frequency]);
+            tail = &(metadata->bucketTail[frame->frequency]);
+        }
+        else if (bm->strategy == RS_ARC && frame->arcList == ARC_T1)
+        {
+            head = &(metadata->t1Head);
+            tail = &(metadata->t1Tail);
+        }
+        else if (bm->strategy == RS_ARC && frame->arcList == ARC_T2)
+        {
+            head = &(metadata->t2Head);
+            tail = &(metadata->t2Tail);
+        }
+        listUnlink(metadata->pageFrames, head, tail, frame);
+    }
+    __atomic_store_n(&(metadata->refBits[frame->frameIndex]), 0, __ATOMIC_RELAXED);
+}
+
+void attachFrame(BM_BufferPool *const bm, BM_PageFrame *frame)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
 
-    // update timestamp
-    pageFrames[frameIndex].timeStamp = getTimeStamp(metadata);
-    if (pageFrames[frameIndex].occupied)
+    // empty frames go in front of the recency list (or the LFU bucket 0), and LRU-K puts 
+    // them first as they have no references
+    frame->frequency = 0;
+    frame->arcList = ARC_NONE;
+    if (bm->strategy == RS_LFU)
     {
-        // remove old mapping
-        removePair(pageTabe, pageFrames[frameIndex].pageNum);
+        listPrepend(metadata->pageFrames, &(metadata->bucketHead[0]), &(metadata->bucketTail[0]), frame);
+        metadata->minFrequency = 0;
+    }
+    else listPrepend(metadata->pageFrames, &(metadata->lruHead), &(metadata->lruTail), frame);
+    if (bm->strategy == RS_LRU_K)
+        heapInsert(metadata, frame);
+}
 
-        // write old frame back to disk if dirty
-        if (pageFrames[frameIndex].dirty) 
+char *mapArena(size_t size, HugePages hugePages, size_t *mappedSize)
+{
+    // an empty pool still gets a page, mmap refuses empty mappings
+    if (size < PAGE_SIZE)
+        size = PAGE_SIZE;
+    size_t hugeSize = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+#ifdef MAP_HUGETLB
+    // reserved huge pages are only available if the administrator set some aside
+    if (hugePages == HP_EXPLICIT)
+    {
+        void *arena = mmap(NULL, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (arena != MAP_FAILED)
         {
-            writeBlock(pageFrames[frameIndex].pageNum, &(metadata->pageFile), pageFrames[frameIndex].data);
-            metadata->numWrite++;
+            *mappedSize = hugeSize;
+            return (char *)arena;
         }
+        hugePages = HP_TRANSPARENT;
     }
+#endif
 
-    // return evicted frame (called must deal with setting the page's metadata)
-    return &(pageFrames[frameIndex]);
-}
\ No newline at end of file
+    if (hugePages != HP_NONE)
+    {
+        // map one huge page more than needed and trim the ends so the arena starts at a huge 
+        // page boundary, otherwise the kernel can not back it with huge pages
+        char *mapping = (char *)mmap(NULL, hugeSize + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == (char *)MAP_FAILED)
+            return NULL;
+        char *arena = (char *)(((uintptr_t)mapping + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+        if (arena > mapping)
+            munmap(mapping, arena - mapping);
+        if (mapping + HUGE_PAGE_SIZE > arena)
+            munmap(arena + hugeSize, mapping + HUGE_PAGE_SIZE - arena);
+#ifdef MADV_HUGEPAGE
+        madvise(arena, hugeSize, MADV_HUGEPAGE);
+#endif
+        *mappedSize = hugeSize;
+        return arena;
+    }
+
+    void *arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (arena == MAP_FAILED)
+        return NULL;
+    *mappedSize = size;
+    return (char *)arena;
+}
+
+void accessFrame(BM_BufferPool *const bm, BM_PageFrame *frame)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+    // scratch frames are not managed by the replacement policy (hits get here without a 
+    // latch while the pool may be resized)
+    if (frame->frameIndex >= __atomic_load_n(&(bm->numPages), __ATOMIC_RELAXED))
+        return;
+
+    // a CLOCK access only sets the frame's reference bit
+    if (bm->strategy == RS_CLOCK)
+        __atomic_store_n(&(metadata->refBits[frame->frameIndex]), 1, __ATOMIC_RELAXED);
+
+    // only unpinned frames are LRU-K victim candidates, the order only changes on references
+    // which happen while a frame is pinned
+    else if (bm->strategy == RS_LRU_K)
+    {
+        if (fixCountOf(metadata, frame->frameIndex) == 0 && frame->heapPos == NO_FRAME)
+            heapInsert(metadata, frame);
+        else if (fixCountOf(metadata, frame->frameIndex) > 0 && frame->heapPos != NO_FRAME)
+            heapRemove(metadata, frame);
+    }
+
+    // only unpinned frames are LFU victim candidates, they join the bucket of their frequency
+    else if (bm->strategy == RS_LFU)
+    {
+        int frequency = frame->frequency;
+        if (fixCountOf(metadata, frame->frameIndex) == 0 && !frame->linked)
+        {
+            listAppend(metadata->pageFrames, &(metadata->bucketHead[frequency]), &(metadata->bucketTail[frequency]), frame);
+            if (frequency < metadata->minFrequency)
+                metadata->minFrequency = frequency;
+        }
+        else if (fixCountOf(metadata, frame->frameIndex) > 0 && frame->linked)
+            listUnlink(metadata->pageFrames, &(metadata->bucketHead[frequency]), &(metadata->bucketTail[frequency]), frame);
+    }
+
+    // only unpinned frames are ARC victim candidates, they join the recency list of T1 or T2
+    // (empty frames are kept in the LRU list)
+    else if (bm->strategy == RS_ARC)
+    {
+        int *head = &(metadata->lruHead);
+        int *tail = &(metadata->lruTail);
+        if (frame->arcList == ARC_T1)
+        {
+            head = &(metadata->t1Head);
+            tail = &(metadata->t1Tail);
+        }
+        else if (frame->arcList == ARC_T2)
+        {
+            head = &(metadata->t2Head);
+            tail = &(metadata->t2Tail);
+        }
+        if (fixCountOf(metadata, frame->frameIndex) == 0 && !frame->linked)
+            listAppend(metadata->pageFrames, head, tail, frame);
+        else if (fixCountOf(metadata, frame->frameIndex) > 0 && frame->linked)
+            listUnlink(metadata->pageFrames, head, tail, frame);
+    }
+
+    else if (bm->strategy == RS_LRU)
+    {
+        // unpinned frames move to the most recently used end, pinned frames stay where they are
+        // until replacementLRU unlinks them (so a hit never changes the list)
+        if (fixCountOf(metadata, frame->frameIndex) == 0)
+        {
+            if (frame->linked)
+                listUnlink(metadata->pageFrames, &(metadata->lruHead), &(metadata->lruTail), frame);
+            listAppend(metadata->pageFrames, &(metadata->lruHead), &(metadata->lruTail), frame);
+        }
+    }
+}
+
+void referenceFrame(BM_BufferPool *const bm, BM_PageFrame *frame)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+    // scratch frames are not managed by the replacement policy (see accessFrame)
+    if (frame->frameIndex >= __atomic_load_n(&(bm->numPages), __ATOMIC_RELAXED))
+        return;
+
+    if (bm->strategy == RS_LRU_K)
+    {
+        // shift the frame's history and record the reference as the most recent one
+        TimeStamp *history = &(metadata->history[frame->frameIndex * metadata->k]);
+        for (int i = metadata->k - 1; i > 0; i--)
+            history[i] = history[i - 1];
+        history[0] = getTimeStamp(metadata);
+    }
+    else if (bm->strategy == RS_LFU)
+    {
+        // references only happen while a frame is pinned, so it is in no bucket
+        if (frame->frequency < LFU_MAX_FREQUENCY)
+            frame->frequency++;
+
+        // age periodically so pages that were hot long ago become evictable again
+        if (--metadata->agingCountdown == 0)
+        {
+            lfuAge(bm);
+            metadata->agingCountdown = metadata->agingPeriod;
+        }
+    }
+    else if (bm->strategy == RS_ARC)
+    {
+        // a new page enters T1, any further reference moves it to T2 (the frame is pinned, so
+        // it joins the right list when it is unpinned)
+        if (frame->arcList == ARC_NONE)
+        {
+            frame->arcList = ARC_T1;
+            metadata->t1Size++;
+        }
+        else if (frame->arcList == ARC_T1)
+        {
+            frame->arcList = ARC_T2;
+            metadata->t1Size--;
+            metadata->t2Size++;
+        }
+    }
+}
+
+void retireFrame(BM_BufferPool *const bm, BM_PageFrame *frame)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+    // scratch frames are not managed by the replacement policy
+    if (frame->frameIndex >= bm->numPages)
+        return;
+
+    if (bm->strategy == RS_LRU_K)
+    {
+        int k = metadata->k;
+        int slot = metadata->ghostCursor;
+        metadata->ghostCursor = (slot + 1) % bm->numPages;
+
+        // the ring is bounded, so the oldest retained history makes room
+        if (metadata->ghostPages[slot] != NO_PAGE)
+            removePair(&(metadata->ghostTable), metadata->ghostPages[slot]);
+
+        // retain the evicted page's history so a quick re-reference can use it
+        metadata->ghostPages[slot] = frame->pageNum;
+        setValue(&(metadata->ghostTable), frame->pageNum, slot);
+        for (int i = 0; i < k; i++)
+        {
+            metadata->ghostHistory[slot * k + i] = metadata->history[frame->frameIndex * k + i];
+            metadata->history[frame->frameIndex * k + i] = 0;
+        }
+    }
+    else if (bm->strategy == RS_ARC)
+    {
+        // remember the page in B1 or B2, the frame still has to leave its list when it is pinned
+        if (frame->arcList == ARC_T1)
+            metadata->t1Size--;
+        else metadata->t2Size--;
+        if (!frame->arcForget)
+            ghostPush(metadata, frame->arcList, frame->pageNum);
+        frame->arcForget = false;
+    }
+}
+
+void installFrame(BM_BufferPool *const bm, BM_PageFrame *frame)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    int slot;
+
+    // scratch frames are not managed by the replacement policy
+    if (frame->frameIndex >= bm->numPages)
+        return;
+
+    // LFU keeps no history of evicted pages (the frame left its bucket when it was pinned)
+    frame->frequency = 0;
+
+    // restore the retained history of a recently evicted page
+    if (bm->strategy == RS_LRU_K && getValue(&(metadata->ghostTable), frame->pageNum, &slot) == 0)
+    {
+        int k = metadata->k;
+        for (int i = 0; i < k; i++)
+            metadata->history[frame->frameIndex * k + i] = metadata->ghostHistory[slot * k + i];
+        removePair(&(metadata->ghostTable), frame->pageNum);
+        metadata->ghostPages[slot] = NO_PAGE;
+    }
+
+    // a page found in B1 or B2 counts as referenced before, so the reference that follows
+    // moves it to T2
+    if (bm->strategy == RS_ARC)
+    {
+        frame->arcList = ARC_NONE;
+        if (getValue(&(metadata->ghostTable), frame->pageNum, &slot) == 0)
+        {
+            ghostDrop(metadata, slot);
+            frame->arcList = ARC_T1;
+            metadata->t1Size++;
+        }
+    }
+}
+
+bool admitPage(BM_BufferPool *const bm, PageNumber pageNum, BM_PageFrame *victim)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+    // filling an empty frame never displaces anything
+    if (!victim->occupied)
+        return true;
+    return estimateFrequency(&(metadata->sketch), pageNum) > estimateFrequency(&(metadata->sketch), victim->pageNum);
+}
+
+BM_PageFrame *getScratchFrame(BM_BufferPool *const bm)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+    for (int i = metadata->maxFrames; i < metadata->numFrames; i++)
+    {
+        if (fixCountOf(metadata, i) == 0)
+            return &(metadata->pageFrames[i]);
+    }
+    return NULL;
+}
+
+void listUnlink(BM_PageFrame *pageFrames, int *head, int *tail, BM_PageFrame *frame)
+{
+    if (frame->prev != NO_FRAME)
+        pageFrames[frame->prev].next = frame->next;
+    else *head = frame->next;
+    if (frame->next != NO_FRAME)
+        pageFrames[frame->next].prev = frame->prev;
+    else *tail = frame->prev;
+    frame->linked = false;
+}
+
+void listAppend(BM_PageFrame *pageFrames, int *head, int *tail, BM_PageFrame *frame)
+{
+    frame->prev = *tail;
+    frame->next = NO_FRAME;
+    if (*tail != NO_FRAME)
+        pageFrames[*tail].next = frame->frameIndex;
+    else *head = frame->frameIndex;
+    *tail = frame->frameIndex;
+    frame->linked = true;
+}
+
+void listPrepend(BM_PageFrame *pageFrames, int *head, int *tail, BM_PageFrame *frame)
+{
+    frame->prev = NO_FRAME;
+    frame->next = *head;
+    if (*head != NO_FRAME)
+        pageFrames[*head].prev = frame->frameIndex;
+    else *tail = frame->frameIndex;
+    *head = frame->frameIndex;
+    frame->linked = true;
+}
+
+int listHead(BM_Metadata *metadata, int *head, int *tail)
+{
+    while (*head != NO_FRAME && fixCountOf(metadata, *head) > 0)
+        listUnlink(metadata->pageFrames, head, tail, &(metadata->pageFrames[*head]));
+    return *head;
+}
+
+int findUnpinned(BM_Metadata *metadata, int from, int to)
+{
+    const int *fixCounts = metadata->fixCounts;
+#ifdef SIMD_X86
+    if (metadata->concurrent)
+        return findUnpinnedScalar(fixCounts, from, to);
+    if (__builtin_cpu_supports("avx2"))
+        return findUnpinnedAVX2(fixCounts, from, to);
+    if (__builtin_cpu_supports("sse2"))
+        return findUnpinnedSSE2(fixCounts, from, to);
+#endif
+    return findUnpinnedScalar(fixCounts, from, to);
+}
+
+int findUnreferenced(BM_Metadata *metadata, int from, int to)
+{
+    const int *fixCounts = metadata->fixCounts;
+    const unsigned char *refBits = metadata->refBits;
+#ifdef SIMD_X86
+    if (metadata->concurrent)
+        return findUnreferencedScalar(fixCounts, refBits, from, to);
+    if (__builtin_cpu_supports("avx2"))
+        return findUnreferencedAVX2(fixCounts, refBits, from, to);
+    if (__builtin_cpu_supports("sse2"))
+        return findUnreferencedSSE2(fixCounts, refBits, from, to);
+#endif
+    return findUnreferencedScalar(fixCounts, refBits, from, to);
+}
+
+int findUnpinnedScalar(const int *fixCounts, int from, int to)
+{
+    for (int i = from; i < to; i++)
+    {
+        if (__atomic_load_n(&(fixCounts[i]), __ATOMIC_RELAXED) == 0)
+            return i;
+    }
+    return NO_FRAME;
+}
+
+int findUnreferencedScalar(const int *fixCounts, const unsigned char *refBits, int from, int to)
+{
+    for (int i = from; i < to; i++)
+    {
+        if (__atomic_load_n(&(fixCounts[i]), __ATOMIC_RELAXED) == 0 
+                && __atomic_load_n(&(refBits[i]), __ATOMIC_RELAXED) == 0)
+            return i;
+    }
+    return NO_FRAME;
+}
+
+#ifdef SIMD_X86
+// the vector kernels compare 4 (SSE2) or 8 (AVX2) frames at once and leave the rest of the 
+// range to the scalar ones
+__attribute__((target("sse2")))
+int findUnpinnedSSE2(const int *fixCounts, int from, int to)
+{
+    __m128i zero = _mm_setzero_si128();
+    int i = from;
+    for (; i + 4 <= to; i += 4)
+    {
+        __m128i counts = _mm_loadu_si128((const __m128i *)(fixCounts + i));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(counts, zero)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+    return findUnpinnedScalar(fixCounts, i, to);
+}
+
+__attribute__((target("avx2")))
+int findUnpinnedAVX2(const int *fixCounts, int from, int to)
+{
+    __m256i zero = _mm256_setzero_si256();
+    int i = from;
+    for (; i + 8 <= to; i += 8)
+    {
+        __m256i counts = _mm256_loadu_si256((const __m256i *)(fixCounts + i));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(counts, zero)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+    return findUnpinnedScalar(fixCounts, i, to);
+}
+
+__attribute__((target("sse2")))
+int findUnreferencedSSE2(const int *fixCounts, const unsigned char *refBits, int from, int to)
+{
+    __m128i zero = _mm_setzero_si128();
+    int i = from;
+    for (; i + 4 <= to; i += 4)
+    {
+        // widen the 4 reference bytes to 4 ints to compare them along with the fix counts
+        int bits;
+        memcpy(&bits, refBits + i, sizeof(int));
+        __m128i refs = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bits), zero), zero);
+        __m128i counts = _mm_loadu_si128((const __m128i *)(fixCounts + i));
+        __m128i both = _mm_or_si128(counts, refs);
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(both, zero)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+    return findUnreferencedScalar(fixCounts, refBits, i, to);
+}
+
+__attribute__((target("avx2")))
+int findUnreferencedAVX2(const int *fixCounts, const unsigned char *refBits, int from, int to)
+{
+    __m256i zero = _mm256_setzero_si256();
+    int i = from;
+    for (; i + 8 <= to; i += 8)
+    {
+        // widen the 8 reference bytes to 8 ints to compare them along with the fix counts
+        __m256i refs = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(refBits + i)));
+        __m256i counts = _mm256_loadu_si256((const __m256i *)(fixCounts + i));
+        __m256i both = _mm256_or_si256(counts, refs);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(both, zero)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+    return findUnreferencedScalar(fixCounts, refBits, i, to);
+}
+#endif
+
+void clearReferences(BM_Metadata *metadata, int from, int to)
+{
+    const int *fixCounts = metadata->fixCounts;
+    unsigned char *refBits = metadata->refBits;
+
+    // in a concurrent pool hits set the bits without the policy latch, so each bit is cleared
+    // on its own (a hit that sets it meanwhile simply wins)
+    if (metadata->concurrent)
+    {
+        for (int i = from; i < to; i++)
+        {
+            if (__atomic_load_n(&(fixCounts[i]), __ATOMIC_RELAXED) == 0)
+                __atomic_store_n(&(refBits[i]), 0, __ATOMIC_RELAXED);
+        }
+        return;
+    }
+
+    // pinned frames keep their bits (written without a branch so the compiler vectorizes it)
+    for (int i = from; i < to; i++)
+        refBits[i] &= (fixCounts[i] != 0);
+}
+
+int fixCountOf(BM_Metadata *metadata, int frameIndex)
+{
+    return __atomic_load_n(&(metadata->fixCounts[frameIndex]), __ATOMIC_RELAXED);
+}
+
+void lfuAge(BM_BufferPool *const bm)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    BM_PageFrame *pageFrames = metadata->pageFrames;
+
+    // pinned frames are in no bucket, so only their frequency changes
+    for (int i = 0; i < bm->numPages; i++)
+    {
+        if (!pageFrames[i].linked)
+            pageFrames[i].frequency /= 2;
+    }
+
+    // move bucket f into bucket f / 2 in increasing order, the target is always processed
+    // already, so frames keep their recency order within a bucket
+    for (int frequency = 1; frequency <= LFU_MAX_FREQUENCY; frequency++)
+    {
+        int current = metadata->bucketHead[frequency];
+        metadata->bucketHead[frequency] = NO_FRAME;
+        metadata->bucketTail[frequency] = NO_FRAME;
+        while (current != NO_FRAME)
+        {
+            BM_PageFrame *frame = &(pageFrames[current]);
+            current = frame->next;
+            frame->frequency = frequency / 2;
+            listAppend(pageFrames, &(metadata->bucketHead[frame->frequency]), &(metadata->bucketTail[frame->frequency]), frame);
+        }
+    }
+    metadata->minFrequency = 0;
+}
+
+void ghostPush(BM_Metadata *metadata, int list, PageNumber pageNum)
+{
+    int *head = (list == ARC_T1) ? &(metadata->b1Head) : &(metadata->b2Head);
+    int *tail = (list == ARC_T1) ? &(metadata->b1Tail) : &(metadata->b2Tail);
+
+    // the ghost lists never outgrow their slots, but never fail if they would
+    if (metadata->ghostFree == NO_FRAME)
+        ghostDrop(metadata, (metadata->b1Head != NO_FRAME) ? metadata->b1Head : metadata->b2Head);
+    int slot = metadata->ghostFree;
+    metadata->ghostFree = metadata->ghostNext[slot];
+
+    metadata->ghostPages[slot] = pageNum;
+    metadata->ghostList[slot] = list;
+    metadata->ghostPrev[slot] = *tail;
+    metadata->ghostNext[slot] = NO_FRAME;
+    if (*tail != NO_FRAME)
+        metadata->ghostNext[*tail] = slot;
+    else *head = slot;
+    *tail = slot;
+    if (list == ARC_T1)
+        metadata->b1Size++;
+    else metadata->b2Size++;
+    setValue(&(metadata->ghostTable), pageNum, slot);
+}
+
+void ghostDrop(BM_Metadata *metadata, int slot)
+{
+    int list = metadata->ghostList[slot];
+    int *head = (list == ARC_T1) ? &(metadata->b1Head) : &(metadata->b2Head);
+    int *tail = (list == ARC_T1) ? &(metadata->b1Tail) : &(metadata->b2Tail);
+
+    if (metadata->ghostPrev[slot] != NO_FRAME)
+        metadata->ghostNext[metadata->ghostPrev[slot]] = metadata->ghostNext[slot];
+    else *head = metadata->ghostNext[slot];
+    if (metadata->ghostNext[slot] != NO_FRAME)
+        metadata->ghostPrev[metadata->ghostNext[slot]] = metadata->ghostPrev[slot];
+    else *tail = metadata->ghostPrev[slot];
+    if (list == ARC_T1)
+        metadata->b1Size--;
+    else metadata->b2Size--;
+    removePair(&(metadata->ghostTable), metadata->ghostPages[slot]);
+
+    // return the slot to the free chain
+    metadata->ghostNext[slot] = metadata->ghostFree;
+    metadata->ghostFree = slot;
+}
+
+bool lruKBefore(BM_Metadata *metadata, int frameA, int frameB)
+{
+    TimeStamp *historyA = &(metadata->history[frameA * metadata->k]);
+    TimeStamp *historyB = &(metadata->history[frameB * metadata->k]);
+    int last = metadata->k - 1;
+
+    // the oldest k-th reference (0 for fewer than k references) has the largest backward 
+    // k-distance, ties are broken by LRU and then by frame order
+    if (historyA[last] != historyB[last])
+        return historyA[last] < historyB[last];
+    if (historyA[0] != historyB[0])
+        return historyA[0] < historyB[0];
+    return frameA < frameB;
+}
+
+void heapInsert(BM_Metadata *metadata, BM_PageFrame *frame)
+{
+    int pos = metadata->heapSize++;
+    metadata->heap[pos] = frame->frameIndex;
+    frame->heapPos = pos;
+    heapMove(metadata, pos);
+}
+
+void heapRemove(BM_Metadata *metadata, BM_PageFrame *frame)
+{
+    int pos = frame->heapPos;
+    int last = --metadata->heapSize;
+    frame->heapPos = NO_FRAME;
+
+    // fill the hole with the last element and restore the heap order around it
+    if (pos != last)
+    {
+        metadata->heap[pos] = metadata->heap[last];
+        metadata->pageFrames[metadata->heap[pos]].heapPos = pos;
+        heapMove(metadata, pos);
+    }
+}
+
+void heapMove(BM_Metadata *metadata, int pos)
+{
+    int *heap = metadata->heap;
+    BM_PageFrame *pageFrames = metadata->pageFrames;
+
+    // sift up
+    while (pos > 0 && lruKBefore(metadata, heap[pos], heap[(pos - 1) / 2]))
+    {
+        int parent = (pos - 1) / 2;
+        int tmp = heap[parent];
+        heap[parent] = heap[pos];
+        heap[pos] = tmp;
+        pageFrames[heap[pos]].heapPos = pos;
+        pageFrames[heap[parent]].heapPos = parent;
+        pos = parent;
+    }
+
+    // sift down
+    while (true)
+    {
+        int smallest = pos;
+        int left = 2 * pos + 1;
+        int right = left + 1;
+        if (left < metadata->heapSize && lruKBefore(metadata, heap[left], heap[smallest]))
+            smallest = left;
+        if (right < metadata->heapSize && lruKBefore(metadata, heap[right], heap[smallest]))
+            smallest = right;
+        if (smallest == pos)
+            break;
+        int tmp = heap[smallest];
+        heap[smallest] = heap[pos];
+        heap[pos] = tmp;
+        pageFrames[heap[pos]].heapPos = pos;
+        pageFrames[heap[smallest]].heapPos = smallest;
+        pos = smallest;
+    }
+}
+
+void setDirty(BM_Metadata *metadata, BM_PageFrame *frame)
+{
+    if (!__atomic_exchange_n(&(frame->dirty), true, __ATOMIC_ACQ_REL))
+    {
+        // wake the background writer up early when the pool reaches its high watermark
+        int numDirty = __atomic_add_fetch(&(metadata->numDirty), 1, __ATOMIC_RELAXED);
+        if (numDirty == __atomic_load_n(&(metadata->dirtyHigh), __ATOMIC_RELAXED) && metadata->owner->writer)
+            pthread_cond_signal(&(metadata->owner->writerWake));
+    }
+}
+
+bool clearDirty(BM_Metadata *metadata, BM_PageFrame *frame)
+{
+    if (__atomic_exchange_n(&(frame->dirty), false, __ATOMIC_ACQ_REL))
+    {
+        __atomic_sub_fetch(&(metadata->numDirty), 1, __ATOMIC_RELAXED);
+        return true;
+    }
+    else return false;
+}
+
+void *runBackgroundWriter(void *arg)
+{
+    BM_Metadata *metadata = (BM_Metadata *)arg;
+    int *frames = (int *)malloc(sizeof(int) * metadata->writerPagesPerRound);
+
+    pthread_mutex_lock(&(metadata->writerLatch));
+    while (!metadata->writerStop)
+    {
+        // sleep for one interval unless a pool reaches its high watermark or shuts down
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)metadata->writerIntervalMs * 1000000;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        pthread_cond_timedwait(&(metadata->writerWake), &(metadata->writerLatch), &deadline);
+        if (metadata->writerStop)
+            break;
+        pthread_mutex_unlock(&(metadata->writerLatch));
+
+        latchFiles(metadata);
+        if (metadata->partitions != NULL)
+        {
+            for (int p = 0; p < metadata->numPartitions; p++)
+                cleanPool(&(metadata->partitions[p]), frames);
+        }
+        else cleanPool(&(metadata->poolHandle), frames);
+        unlatchFiles(metadata);
+
+        pthread_mutex_lock(&(metadata->writerLatch));
+    }
+    pthread_mutex_unlock(&(metadata->writerLatch));
+    free(frames);
+    return NULL;
+}
+
+void stopBackgroundWriter(BM_Metadata *metadata)
+{
+    if (metadata->writer)
+    {
+        pthread_mutex_lock(&(metadata->writerLatch));
+        metadata->writerStop = true;
+        pthread_cond_signal(&(metadata->writerWake));
+        pthread_mutex_unlock(&(metadata->writerLatch));
+        pthread_join(metadata->writerThread, NULL);
+        pthread_mutex_destroy(&(metadata->writerLatch));
+        pthread_cond_destroy(&(metadata->writerWake));
+        metadata->writer = false;
+    }
+}
+
+RC prefetchPage(BM_BufferPool *const bm, PageNumber pageNum)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    BM_Metadata *owner = metadata->owner;
+    BM_PageFrame *frame;
+    int frameIndex;
+
+    // resident pages need nothing
+    if (getValue(&(metadata->pageTable), pageNum, &frameIndex) == 0)
+        return RC_OK;
+
+    // TinyLFU counts the prefetch as a request, so the page can win against the victim
+    if (metadata->admission)
+    {
+        latchPolicy(metadata);
+        incrementFrequency(&(metadata->sketch), pageNum);
+        unlatchPolicy(metadata);
+    }
+
+    int reserved = reserveFrame(bm, pageNum, &frame);
+
+    // if all frames are pinned (or the victim can not be written), there is nowhere to 
+    // prefetch to
+    if (reserved == RESERVE_FULL || reserved == RESERVE_WRITE_FAILED)
+        return RC_WRITE_FAILED;
+    else if (reserved == RESERVE_RESIDENT)
+        releaseFrame(bm, frame);
+    else if (owner->numPrefetchThreads > 0)
+    {
+        // queue the read, the frame stays pinned until it is read
+        BM_PrefetchRequest *request = (BM_PrefetchRequest *)malloc(sizeof(BM_PrefetchRequest));
+        request->pool = bm;
+        request->frame = frame;
+        request->next = NULL;
+        pthread_mutex_lock(&(owner->prefetchLatch));
+        if (owner->prefetchTail != NULL)
+            owner->prefetchTail->next = request;
+        else owner->prefetchHead = request;
+        owner->prefetchTail = request;
+        owner->numPrefetches++;
+        pthread_cond_signal(&(owner->prefetchWake));
+        pthread_mutex_unlock(&(owner->prefetchLatch));
+    }
+    else if (readFrame(metadata, frame) != RC_OK)
+        failRead(bm, frame);
+    else
+    {
+        finishRead(metadata, frame);
+        releaseFrame(bm, frame);
+    }
+    return RC_OK;
+}
+
+void *runPrefetcher(void *arg)
+{
+    BM_Metadata *metadata = (BM_Metadata *)arg;
+
+    pthread_mutex_lock(&(metadata->prefetchLatch));
+    while (true)
+    {
+        // the queue is drained before the threads stop
+        while (metadata->prefetchHead == NULL && !metadata->prefetchStop)
+            pthread_cond_wait(&(metadata->prefetchWake), &(metadata->prefetchLatch));
+        if (metadata->prefetchHead == NULL)
+            break;
+        BM_PrefetchRequest *request = metadata->prefetchHead;
+        metadata->prefetchHead = request->next;
+        if (metadata->prefetchHead == NULL)
+            metadata->prefetchTail = NULL;
+        pthread_mutex_unlock(&(metadata->prefetchLatch));
+
+        // read the page and make the frame evictable again
+        BM_Metadata *pool = (BM_Metadata *)request->pool->mgmtData;
+        if (readFrame(pool, request->frame) != RC_OK)
+            failRead(request->pool, request->frame);
+        else
+        {
+            finishRead(pool, request->frame);
+            releaseFrame(request->pool, request->frame);
+        }
+        free(request);
+
+        pthread_mutex_lock(&(metadata->prefetchLatch));
+        if (--metadata->numPrefetches == 0)
+            pthread_cond_broadcast(&(metadata->prefetchIdle));
+    }
+    pthread_mutex_unlock(&(metadata->prefetchLatch));
+    return NULL;
+}
+
+void waitForPrefetches(BM_Metadata *metadata)
+{
+    if (metadata->numPrefetchThreads > 0)
+    {
+        pthread_mutex_lock(&(metadata->prefetchLatch));
+        while (metadata->numPrefetches > 0)
+            pthread_cond_wait(&(metadata->prefetchIdle), &(metadata->prefetchLatch));
+        pthread_mutex_unlock(&(metadata->prefetchLatch));
+    }
+}
+
+void stopPrefetchers(BM_Metadata *metadata)
+{
+    if (metadata->numPrefetchThreads > 0)
+    {
+        pthread_mutex_lock(&(metadata->prefetchLatch));
+        metadata->prefetchStop = true;
+        pthread_cond_broadcast(&(metadata->prefetchWake));
+        pthread_mutex_unlock(&(metadata->prefetchLatch));
+        for (int i = 0; i < metadata->numPrefetchThreads; i++)
+            pthread_join(metadata->prefetchThreads[i], NULL);
+        free(metadata->prefetchThreads);
+        pthread_mutex_destroy(&(metadata->prefetchLatch));
+        pthread_cond_destroy(&(metadata->prefetchWake));
+        pthread_cond_destroy(&(metadata->prefetchIdle));
+        metadata->numPrefetchThreads = 0;
+    }
+}
+
+void cleanPool(BM_BufferPool *const bm, int *frames)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    int maxFrames = metadata->owner->writerPagesPerRound;
+
+    // clean from the high watermark down to the low one
+    int numDirty = __atomic_load_n(&(metadata->numDirty), __ATOMIC_RELAXED);
+    if (numDirty >= __atomic_load_n(&(metadata->dirtyHigh), __ATOMIC_RELAXED) && numDirty > 0)
+        metadata->writerCleaning = true;
+    if (numDirty <= __atomic_load_n(&(metadata->dirtyLow), __ATOMIC_RELAXED))
+        metadata->writerCleaning = false;
+    if (!metadata->writerCleaning)
+        return;
+
+    latchPolicy(metadata);
+    int numFrames = getDirtyVictims(bm, frames, maxFrames);
+    unlatchPolicy(metadata);
+
+    // write the frames that are still dirty and unpinned, a frame that got pinned meanwhile
+    // is left alone (the writer does not change the replacement order), a page that fails to
+    // be written stays dirty and ends the round
+    for (int i = 0; i < numFrames; i++)
+    {
+        BM_PageFrame *frame = &(metadata->pageFrames[frames[i]]);
+        bool failed = false;
+        latchFrame(metadata, frame);
+        if (frame->occupied && fixCountOf(metadata, frame->frameIndex) == 0 && clearDirty(metadata, frame)
+                && writeFrame(metadata, frame) != RC_OK)
+        {
+            setDirty(metadata, frame);
+            failed = true;
+        }
+        unlatchFrame(metadata, frame);
+        if (failed)
+            break;
+    }
+}
+
+int getDirtyVictims(BM_BufferPool *const bm, int *frames, int maxFrames)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    BM_PageFrame *pageFrames = metadata->pageFrames;
+    int numScan = WRITER_SCAN_FACTOR * maxFrames;
+    int numFrames = 0;
+
+    // walk the frames in (roughly) the order the replacement policy evicts them, but look at
+    // no more than numScan frames
+    if (bm->strategy == RS_FIFO || bm->strategy == RS_CLOCK)
+    {
+        // the frames after the queue index or from the CLOCK hand on
+        int start = (bm->strategy == RS_FIFO) ? metadata->queueIndex + 1 : metadata->clockHand;
+        for (int i = 0; i < bm->numPages && i < numScan && numFrames < maxFrames; i++)
+            addDirtyVictim(metadata, (start + i) % bm->numPages, frames, &numFrames);
+    }
+    else if (bm->strategy == RS_LRU_K)
+    {
+        // the heap's array is ordered by level, so its start holds the next victims
+        for (int i = 0; i < metadata->heapSize && i < numScan && numFrames < maxFrames; i++)
+            addDirtyVictim(metadata, metadata->heap[i], frames, &numFrames);
+    }
+    else if (bm->strategy == RS_LFU)
+    {
+        // the buckets from the lowest frequency up
+        for (int frequency = metadata->minFrequency; frequency <= LFU_MAX_FREQUENCY; frequency++)
+        {
+            for (int f = metadata->bucketHead[frequency]; f != NO_FRAME && numScan-- > 0 && numFrames < maxFrames; f = pageFrames[f].next)
+                addDirtyVictim(metadata, f, frames, &numFrames);
+        }
+    }
+    else if (bm->strategy == RS_ARC)
+    {
+        // the list that is above its target first
+        bool t1First = metadata->t1Size > metadata->arcTarget;
+        int first = t1First ? metadata->t1Head : metadata->t2Head;
+        int second = t1First ? metadata->t2Head : metadata->t1Head;
+        for (int f = first; f != NO_FRAME && numScan-- > 0 && numFrames < maxFrames; f = pageFrames[f].next)
+            addDirtyVictim(metadata, f, frames, &numFrames);
+        for (int f = second; f != NO_FRAME && numScan-- > 0 && numFrames < maxFrames; f = pageFrames[f].next)
+            addDirtyVictim(metadata, f, frames, &numFrames);
+    }
+    else // if (bm->strategy == RS_LRU)
+    {
+        for (int f = metadata->lruHead; f != NO_FRAME && numScan-- > 0 && numFrames < maxFrames; f = pageFrames[f].next)
+            addDirtyVictim(metadata, f, frames, &numFrames);
+    }
+    return numFrames;
+}
+
+void addDirtyVictim(BM_Metadata *metadata, int frameIndex, int *frames, int *numFrames)
+{
+    BM_PageFrame *frame = &(metadata->pageFrames[frameIndex]);
+    if (frame->occupied && __atomic_load_n(&(frame->dirty), __ATOMIC_RELAXED) && fixCountOf(metadata, frame->frameIndex) == 0)
+        frames[(*numFrames)++] = frameIndex;
+}
+
+BM_BufferPool *getPartition(BM_BufferPool *const bm, PageNumber pageNum)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+    // multiplicative hashing spreads runs and strides of page numbers over all partitions,
+    // the high bits of the product select the partition (the high half of the page number is
+    // folded in first)
+    unsigned int hash = (unsigned int)(pageNum ^ (pageNum >> 32)) * 2654435761u;
+    return &(metadata->partitions[((unsigned long long)hash * metadata->numPartitions) >> 32]);
+}
+
+TimeStamp getTimeStamp(BM_Metadata *metadata)
+{
+    // increment the global timestamp before returning it, so 0 never refers to a reference
+    return ++metadata->timeStamp;
+}
+
+BM_PageFrame *getVictim(BM_BufferPool *const bm, PageNumber pageNum)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    BM_PageFrame *pageFrame;
+
+    latchPolicy(metadata);
+    while (true)
+    {
+        // use specified replacement strategy, it only chooses the victim
+        if (bm->strategy == RS_FIFO)
+            pageFrame = replacementFIFO(bm);
+        else if (bm->strategy == RS_CLOCK)
+            pageFrame = replacementCLOCK(bm);
+        else if (bm->strategy == RS_LRU_K)
+            pageFrame = replacementLRUK(bm);
+        else if (bm->strategy == RS_LFU)
+            pageFrame = replacementLFU(bm);
+        else if (bm->strategy == RS_ARC)
+            pageFrame = replacementARC(bm, pageNum);
+        else // if (bm->strategy == RS_LRU)
+            pageFrame = replacementLRU(bm);
+
+        // all frames are pinned
+        if (pageFrame == NULL)
+            break;
+
+        // serve pages requested less often than the victim's page from a scratch frame, the
+        // policy is left as it was
+        BM_PageFrame *victim = pageFrame;
+        if (metadata->admission && !admitPage(bm, pageNum, pageFrame))
+        {
+            BM_PageFrame *scratchFrame = getScratchFrame(bm);
+            if (scratchFrame != NULL)
+                pageFrame = scratchFrame;
+        }
+
+        // a concurrent hit may pin the frame before it is claimed, then choose again
+        if (claimFrame(metadata, pageFrame))
+        {
+            if (pageFrame == victim)
+                commitVictim(bm, pageNum, victim);
+            break;
+        }
+    }
+    unlatchPolicy(metadata);
+    return pageFrame;
+}
+
+int reserveFrame(BM_BufferPool *const bm, PageNumber pageNum, BM_PageFrame **frame)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    BM_PageFrame *pageFrames = metadata->pageFrames;
+    HT_TableHandle *pageTabe = &(metadata->pageTable);
+    int frameIndex;
+
+    while (true)
+    {
+        BM_PageFrame *pageFrame = getVictim(bm, pageNum);
+
+        // all frames are pinned
+        if (pageFrame == NULL)
+            return RESERVE_FULL;
+
+        // write the old page back to disk if dirty (the victim is pinned by now, so only a flush
+        // that started before can hold its latch), a page that fails to be written stays dirty
+        // and in the frame
+        latchFrame(metadata, pageFrame);
+        if (pageFrame->occupied && clearDirty(metadata, pageFrame) && writeFrame(metadata, pageFrame) != RC_OK)
+        {
+            setDirty(metadata, pageFrame);
+            unlatchFrame(metadata, pageFrame);
+            releaseFrame(bm, pageFrame);
+            return RESERVE_WRITE_FAILED;
+        }
+        unlatchFrame(metadata, pageFrame);
+
+        latchTable(metadata);
+
+        // a concurrent miss loaded the page meanwhile, so pin its frame instead
+        if (getValue(pageTabe, pageNum, &frameIndex) == 0)
+        {
+            __atomic_add_fetch(&(metadata->fixCounts[frameIndex]), 1, __ATOMIC_ACQ_REL);
+            releaseFrame(bm, pageFrame);
+            unlatchTable(metadata);
+            *frame = &(pageFrames[frameIndex]);
+            return RESERVE_RESIDENT;
+        }
+
+        // hits pin frames without a latch, so the old page is unmapped for them before the 
+        // fix count is checked: a hit either pinned the frame before the check, or it sees 
+        // tablePage change when it checks it after pinning
+        PageNumber oldPage = pageFrame->tablePage;
+        __atomic_store_n(&(pageFrame->tablePage), NO_PAGE, __ATOMIC_SEQ_CST);
+
+        // the old page was pinned or dirtied again during the write, so choose another victim
+        if (__atomic_load_n(&(metadata->fixCounts[pageFrame->frameIndex]), __ATOMIC_SEQ_CST) != 1
+                || __atomic_load_n(&(pageFrame->dirty), __ATOMIC_SEQ_CST))
+        {
+            __atomic_store_n(&(pageFrame->tablePage), oldPage, __ATOMIC_SEQ_CST);
+            releaseFrame(bm, pageFrame);
+            unlatchTable(metadata);
+            continue;
+        }
+
+        // move the mapping to the new page, pins of it wait until it is read
+        if (pageFrame->occupied)
+            removePair(pageTabe, pageFrame->pageNum);
+        setValue(pageTabe, pageNum, pageFrame->frameIndex);
+        pageFrame->state = FRAME_READING;
+        __atomic_store_n(&(pageFrame->tablePage), pageNum, __ATOMIC_RELEASE);
+
+        // set frame's metadata
+        latchPolicy(metadata);
+        if (pageFrame->occupied)
+            retireFrame(bm, pageFrame);
+        pageFrame->occupied = true;
+        pageFrame->pageNum = pageNum;
+        accessFrame(bm, pageFrame);
+        installFrame(bm, pageFrame);
+        referenceFrame(bm, pageFrame);
+        unlatchPolicy(metadata);
+        unlatchTable(metadata);
+
+        *frame = pageFrame;
+        return RESERVE_READING;
+    }
+}
+
+RC pinResident(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    int frameIndex;
+
+    // get the mapped frameIndex from pageNum, a hit takes no latch: it pins the frame and 
+    // then checks that no miss is moving the frame to another page (see reserveFrame)
+    while (getValue(&(metadata->pageTable), pageNum, &frameIndex) == 0)
+    {
+        BM_PageFrame *frame = &(metadata->pageFrames[frameIndex]);
+        __atomic_add_fetch(&(metadata->fixCounts[frameIndex]), 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&(frame->tablePage), __ATOMIC_SEQ_CST) == pageNum)
+            return pinFrame(bm, page, frame, false);
+
+        // drop the pin and look the page up again
+        releaseFrame(bm, frame);
+    }
+    return RC_IM_KEY_NOT_FOUND;
+}
+
+RC loadPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    BM_PageFrame *pageFrame;
+
+    // TinyLFU counts every request, hits included
+    if (metadata->admission)
+    {
+        latchPolicy(metadata);
+        incrementFrequency(&(metadata->sketch), pageNum);
+        unlatchPolicy(metadata);
+    }
+
+    int reserved = reserveFrame(bm, pageNum, &pageFrame);
+
+    // if the strategy failed (i.e. all frames are pinned) or the victim's page could not be
+    // written return error
+    if (reserved == RESERVE_FULL || reserved == RESERVE_WRITE_FAILED)
+        return RC_WRITE_FAILED;
+    else if (reserved == RESERVE_RESIDENT)
+        return pinFrame(bm, page, pageFrame, true);
+    else
+    {
+        // read data from disk
+        RC result = readFrame(metadata, pageFrame);
+        if (result != RC_OK)
+        {
+            failRead(bm, pageFrame);
+            return result;
+        }
+        finishRead(metadata, pageFrame);
+
+        page->data = pageFrame->data;
+        page->pageNum = pageNum;
+        return RC_OK;
+    }
+}
+
+RC pinFrame(BM_BufferPool *const bm, BM_PageHandle *const page, BM_PageFrame *frame, bool counted)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+    // wait until the miss or prefetch that loads the page has read it, if the read failed
+    // the page is not in the frame anymore
+    waitForRead(metadata, frame);
+    if (__atomic_load_n(&(frame->state), __ATOMIC_ACQUIRE) == FRAME_FAILED)
+    {
+        releaseFrame(bm, frame);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    if (metadata->latchHits)
+        latchPolicy(metadata);
+
+    // TinyLFU counts every request, hits included
+    if (metadata->admission && !counted)
+        incrementFrequency(&(metadata->sketch), frame->pageNum);
+    accessFrame(bm, frame);
+    referenceFrame(bm, frame);
+    if (metadata->latchHits)
+        unlatchPolicy(metadata);
+
+    page->data = frame->data;
+    page->pageNum = frame->pageNum;
+    return RC_OK;
+}
+
+void finishRead(BM_Metadata *metadata, BM_PageFrame *frame)
+{
+    if (metadata->concurrent)
+    {
+        pthread_mutex_lock(&(metadata->readLatch));
+        __atomic_store_n(&(frame->state), FRAME_READY, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&(metadata->readDone));
+        pthread_mutex_unlock(&(metadata->readLatch));
+    }
+    else frame->state = FRAME_READY;
+}
+
+void waitForRead(BM_Metadata *metadata, BM_PageFrame *frame)
+{
+    if (__atomic_load_n(&(frame->state), __ATOMIC_ACQUIRE) == FRAME_READING)
+    {
+        pthread_mutex_lock(&(metadata->readLatch));
+        while (__atomic_load_n(&(frame->state), __ATOMIC_ACQUIRE) == FRAME_READING)
+            pthread_cond_wait(&(metadata->readDone), &(metadata->readLatch));
+        pthread_mutex_unlock(&(metadata->readLatch));
+    }
+}
+
+void failRead(BM_BufferPool *const bm, BM_PageFrame *frame)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+    // unmap the page so the next pin of it misses and reads it again, the frame goes back 
+    // to the policy as an empty frame (like the frames of a new pool)
+    latchTable(metadata);
+    __atomic_store_n(&(frame->tablePage), NO_PAGE, __ATOMIC_SEQ_CST);
+    removePair(&(metadata->pageTable), frame->pageNum);
+    latchPolicy(metadata);
+    if (frame->frameIndex < bm->numPages)
+    {
+        detachFrame(bm, frame);
+        retireFrame(bm, frame);
+        attachFrame(bm, frame);
+    }
+    frame->occupied = false;
+    unlatchPolicy(metadata);
+    unlatchTable(metadata);
+
+    // wake the pins that waited for the read, then drop our own pin without touching the 
+    // replacement order again
+    if (metadata->concurrent)
+    {
+        pthread_mutex_lock(&(metadata->readLatch));
+        __atomic_store_n(&(frame->state), FRAME_FAILED, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&(metadata->readDone));
+        pthread_mutex_unlock(&(metadata->readLatch));
+    }
+    else frame->state = FRAME_FAILED;
+    __atomic_sub_fetch(&(metadata->fixCounts[frame->frameIndex]), 1, __ATOMIC_ACQ_REL);
+}
+
+bool claimFrame(BM_Metadata *metadata, BM_PageFrame *frame)
+{
+    int unpinned = 0;
+    return __atomic_compare_exchange_n(&(metadata->fixCounts[frame->frameIndex]), &unpinned, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+void releaseFrame(BM_BufferPool *const bm, BM_PageFrame *frame)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+
+    __atomic_sub_fetch(&(metadata->fixCounts[frame->frameIndex]), 1, __ATOMIC_ACQ_REL);
+    latchPolicy(metadata);
+    accessFrame(bm, frame);
+    unlatchPolicy(metadata);
+}
+
+RC openFile(BM_Metadata *owner, int fileId, const char *fileName)
+{
+    BM_File *file = (BM_File *)malloc(sizeof(BM_File));
+    file->fileName = strdup(fileName);
+    RC result = openPageFileWithFlags(file->fileName, &(file->pageFile), owner->openFlags);
+
+    // the frames have the page size of the pool's own file, so all files must have it
+    if (result == RC_OK && fileId > 0 && file->pageFile.pageSize != owner->files[0]->pageFile.pageSize)
+    {
+        closePageFile(&(file->pageFile));
+        result = RC_INVALID_STRATEGY_DATA;
+    }
+    if (result != RC_OK)
+    {
+        free(file->fileName);
+        free(file);
+        return result;
+    }
+
+    setPreallocation(&(file->pageFile), owner->preallocatePages);
+    file->numRegistrations = 1;
+    if (owner->concurrent)
+        pthread_rwlock_init(&(file->fileLatch), NULL);
+    file->async = owner->ioQueueDepth > 0 
+            && initAsyncIO(&(file->asyncIO), &(file->pageFile), owner->ioQueueDepth, SM_ASYNC_URING) == RC_OK;
+    if (file->async)
+        pthread_mutex_init(&(file->asyncLatch), NULL);
+    file->asyncStalled = false;
+    file->advice = SM_ADVICE_NORMAL;
+
+    // pins of the file's pages may look it up as soon as it is published
+    __atomic_store_n(&(owner->files[fileId]), file, __ATOMIC_RELEASE);
+    return RC_OK;
+}
+
+void closeFile(BM_Metadata *owner, int fileId)
+{
+    BM_File *file = owner->files[fileId];
+    if (file == NULL)
+        return;
+    __atomic_store_n(&(owner->files[fileId]), NULL, __ATOMIC_RELEASE);
+    if (file->async)
+    {
+        shutdownAsyncIO(&(file->asyncIO));
+        pthread_mutex_destroy(&(file->asyncLatch));
+    }
+    closePageFile(&(file->pageFile));
+    if (owner->concurrent)
+        pthread_rwlock_destroy(&(file->fileLatch));
+    free(file->fileName);
+    free(file);
+}
+
+BM_File *fileOf(BM_Metadata *owner, PageNumber pageNum)
+{
+    return __atomic_load_n(&(owner->files[PAGE_FILE_ID(pageNum)]), __ATOMIC_ACQUIRE);
+}
+
+bool fileCached(BM_Metadata *owner, int fileId, bool pinnedOnly)
+{
+    // pages of a file that is not registered are not loaded, so the frames holding them do 
+    // not change
+    int numPools = (owner->partitions != NULL) ? owner->numPartitions : 1;
+    for (int p = 0; p < numPools; p++)
+    {
+        BM_Metadata *metadata = (owner->partitions != NULL) ? (BM_Metadata *)owner->partitions[p].mgmtData : owner;
+        for (int i = 0; i < metadata->numFrames; i++)
+        {
+            BM_PageFrame *frame = &(metadata->pageFrames[i]);
+            if (frame->occupied && PAGE_FILE_ID(frame->pageNum) == fileId 
+                    && (!pinnedOnly || __atomic_load_n(&(metadata->fixCounts[i]), __ATOMIC_RELAXED) > 0))
+                return true;
+        }
+    }
+    return false;
+}
+
+RC checkFile(BM_Metadata *metadata, PageNumber pageNum)
+{
+    if (pageNum < 0)
+        return RC_IM_KEY_NOT_FOUND;
+    if (PAGE_FILE_ID(pageNum) >= MAX_POOL_FILES || fileOf(metadata->owner, pageNum) == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    return RC_OK;
+}
+
+RC checkPage(BM_Metadata *metadata, PageNumber pageNum)
+{
+    RC result = checkFile(metadata, pageNum);
+    if (result != RC_OK)
+        return result;
+    BM_File *file = fileOf(metadata->owner, pageNum);
+
+    // a mapped pool cannot grow the file
+    if (metadata->owner->mapped && PAGE_IN_FILE(pageNum) >= file->pageFile.totalNumPages)
+        return RC_READ_NON_EXISTING_PAGE;
+    return RC_OK;
+}
+
+void adviseMapping(BM_Metadata *owner, PageNumber pageNum)
+{
+    // the pattern is a heuristic, so concurrent misses update it without a latch
+    PageNumber lastMiss = __atomic_exchange_n(&(owner->lastMiss), pageNum, __ATOMIC_RELAXED);
+    int score = __atomic_load_n(&(owner->sequentialScore), __ATOMIC_RELAXED);
+    if (pageNum == lastMiss + 1 && score < 2 * MAPPED_SEQUENTIAL_SCORE)
+        score++;
+    else if (pageNum != lastMiss + 1 && score > 0)
+        score--;
+    __atomic_store_n(&(owner->sequentialScore), score, __ATOMIC_RELAXED);
+
+    // switch the advice for the whole mapping of the page's file when the pattern changes
+    BM_File *file = fileOf(owner, pageNum);
+    SM_Advice advice = __atomic_load_n(&(file->advice), __ATOMIC_RELAXED);
+    if (score >= MAPPED_SEQUENTIAL_SCORE)
+        advice = SM_ADVICE_SEQUENTIAL;
+    else if (score == 0)
+        advice = SM_ADVICE_RANDOM;
+    PageNumber numPages = file->pageFile.totalNumPages;
+    if (__atomic_exchange_n(&(file->advice), advice, __ATOMIC_RELAXED) != advice)
+        adviseBlocks(0, numPages, &(file->pageFile), advice);
+
+    // a scan asks for the next pages ahead of time
+    PageNumber localPage = PAGE_IN_FILE(pageNum);
+    if (advice == SM_ADVICE_SEQUENTIAL && localPage % MAPPED_READAHEAD == 0 && localPage + 1 < numPages)
+    {
+        int numAhead = (numPages - localPage - 1 < MAPPED_READAHEAD) ? (int)(numPages - localPage - 1) : MAPPED_READAHEAD;
+        adviseBlocks(localPage + 1, numAhead, &(file->pageFile), SM_ADVICE_WILLNEED);
+    }
+}
+
+RC growFile(BM_Metadata *owner, BM_File *file, PageNumber numberOfPages, PageNumber *oldNumPages)
+{
+    *oldNumPages = file->pageFile.totalNumPages;
+    if (!owner->concurrent)
+        return ensureCapacity(numberOfPages, &(file->pageFile));
+
+    // the file never shrinks, so once it is long enough the shared latch is kept for the I/O
+    pthread_rwlock_rdlock(&(file->fileLatch));
+    *oldNumPages = file->pageFile.totalNumPages;
+    if (*oldNumPages >= numberOfPages)
+        return RC_OK;
+    pthread_rwlock_unlock(&(file->fileLatch));
+
+    pthread_rwlock_wrlock(&(file->fileLatch));
+    *oldNumPages = file->pageFile.totalNumPages;
+    RC result = ensureCapacity(numberOfPages, &(file->pageFile));
+    pthread_rwlock_unlock(&(file->fileLatch));
+    pthread_rwlock_rdlock(&(file->fileLatch));
+    return result;
+}
+
+int zeroNewFrames(BM_FrameRef *refs, int numRefs, PageNumber oldNumPages)
+{
+    int numOld = numRefs;
+    while (numOld > 0 && PAGE_IN_FILE(refs[numOld - 1].frame->pageNum) >= oldNumPages)
+        numOld--;
+    for (int i = numOld; i < numRefs; i++)
+        memset(refs[i].frame->data, 0, ((BM_Metadata *)refs[i].pool->mgmtData)->owner->files[0]->pageFile.pageSize);
+    return numOld;
+}
+
+int fileRunEnd(BM_FrameRef *refs, int start, int numRefs)
+{
+    int end = start + 1;
+    while (end < numRefs && PAGE_FILE_ID(refs[end].frame->pageNum) == PAGE_FILE_ID(refs[start].frame->pageNum))
+        end++;
+    return end;
+}
+
+RC readFrame(BM_Metadata *metadata, BM_PageFrame *frame)
+{
+    BM_Metadata *owner = metadata->owner;
+    BM_File *file = fileOf(owner, frame->pageNum);
+    PageNumber localPage = PAGE_IN_FILE(frame->pageNum);
+
+    // a mapped pool points the frame at the page in the mapping instead of reading it, the
+    // kernel reads it once it is first touched (it still counts as a read I/O)
+    if (owner->mapped)
+    {
+        frame->data = getMappedBlock(localPage, &(file->pageFile));
+        adviseMapping(owner, frame->pageNum);
+        __atomic_add_fetch(&(metadata->numRead), 1, __ATOMIC_RELAXED);
+        return RC_OK;
+    }
+
+    // grow the file if needed, a page the file did not have yet is all zeros and not read
+    PageNumber oldNumPages;
+    RC result = growFile(owner, file, localPage + 1, &oldNumPages);
+    if (result == RC_OK && localPage >= oldNumPages)
+        memset(frame->data, 0, file->pageFile.pageSize);
+    else if (result == RC_OK)
+        result = readBlock(localPage, &(file->pageFile), frame->data);
+
+    if (owner->concurrent)
+        pthread_rwlock_unlock(&(file->fileLatch));
+    __atomic_add_fetch(&(metadata->numRead), 1, __ATOMIC_RELAXED);
+    return result;
+}
+
+RC readFrames(BM_FrameRef *refs, int numRefs)
+{
+    if (numRefs == 0)
+        return RC_OK;
+    BM_Metadata *owner = ((BM_Metadata *)refs[0].pool->mgmtData)->owner;
+    RC result = RC_OK;
+    if (owner->mapped)
+    {
+        for (int i = 0; i < numRefs; i++)
+        {
+            refs[i].result = readFrame((BM_Metadata *)refs[i].pool->mgmtData, refs[i].frame);
+            if (refs[i].result != RC_OK)
+                result = refs[i].result;
+        }
+        return result;
+    }
+
+    char **pages = malloc(numRefs * sizeof(char *));
+
+    // the refs are sorted by page number, so the pages of each file are next to each other
+    for (int fileStart = 0, fileEnd; fileStart < numRefs; fileStart = fileEnd)
+    {
+        fileEnd = fileRunEnd(refs, fileStart, numRefs);
+        BM_File *file = fileOf(owner, refs[fileStart].frame->pageNum);
+        if (file->async)
+        {
+            RC fileResult = transferFramesAsync(owner, file, &refs[fileStart], fileEnd - fileStart, false);
+            if (fileResult != RC_OK)
+                result = fileResult;
+            continue;
+        }
+
+        for (int start = fileStart, end; start < fileEnd; start = end)
+        {
+            // collect the run of consecutive pages starting at refs[start]
+            pages[0] = refs[start].frame->data;
+            for (end = start + 1; end < fileEnd && refs[end].frame->pageNum == refs[end - 1].frame->pageNum + 1; end++)
+                pages[end - start] = refs[end].frame->data;
+
+            // grow the file if needed, only the part of the run the file already had is read
+            PageNumber oldNumPages;
+            RC runResult = growFile(owner, file, PAGE_IN_FILE(refs[end - 1].frame->pageNum) + 1, &oldNumPages);
+            int numOld = (runResult == RC_OK) ? zeroNewFrames(&refs[start], end - start, oldNumPages) : 0;
+            if (numOld > 0)
+                runResult = readBlocks(PAGE_IN_FILE(refs[start].frame->pageNum), numOld, &(file->pageFile), pages);
+
+            if (owner->concurrent)
+                pthread_rwlock_unlock(&(file->fileLatch));
+            if (runResult != RC_OK)
+                result = runResult;
+
+            // the I/O is still counted per page
+            for (int i = start; i < end; i++)
+            {
+                refs[i].result = runResult;
+                __atomic_add_fetch(&(((BM_Metadata *)refs[i].pool->mgmtData)->numRead), 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    free(pages);
+    return result;
+}
+
+int getFlushFrames(BM_BufferPool *const bm, BM_FrameRef *refs, int fileId)
+{
+    BM_Metadata *metadata = (BM_Metadata *)bm->mgmtData;
+    int numRefs = 0;
+
+    for (int i = 0; i < metadata->numFrames; i++)
+    {
+        BM_PageFrame *frame = &(metadata->pageFrames[i]);
+        if (!__atomic_load_n(&(frame->dirty), __ATOMIC_RELAXED))
+            continue;
+
+        // the frames of the other files are not claimed, releasing them would count as an 
+        // access to the replacement strategy (a frame whose page is changing is checked again
+        // below)
+        PageNumber tablePage = __atomic_load_n(&(frame->tablePage), __ATOMIC_ACQUIRE);
+        if (fileId != ALL_FILES && tablePage != NO_PAGE && PAGE_FILE_ID(tablePage) != fileId)
+            continue;
+
+        // pinning the frame keeps misses from reusing it and the background writer from 
+        // writing it while the flush writes it
+        if (!claimFrame(metadata, frame))
+            continue;
+
+        // clear the dirty bool first, so a page dirtied during the write stays dirty (a write
+        // that started before holds the frame latch and may have cleaned it already), pages of
+        // the other files are left dirty
+        latchFrame(metadata, frame);
+        bool dirty = frame->occupied && (fileId == ALL_FILES || PAGE_FILE_ID(frame->pageNum) == fileId) 
+                && clearDirty(metadata, frame);
+        unlatchFrame(metadata, frame);
+
+        if (dirty)
+        {
+            refs[numRefs].pool = bm;
+            refs[numRefs].frame = frame;
+            refs[numRefs].index = i;
+            numRefs++;
+        }
+        else releaseFrame(bm, frame);
+    }
+    return numRefs;
+}
+
+RC flushFrames(BM_Metadata *owner, BM_FrameRef *refs, int numRefs)
+{
+    // with asynchronous I/O each file's frames go through the file's own queue
+    if (owner->ioQueueDepth > 0)
+    {
+        RC result = RC_OK;
+        for (int start = 0, end; start < numRefs; start = end)
+        {
+            end = fileRunEnd(refs, start, numRefs);
+            BM_File *file = fileOf(owner, refs[start].frame->pageNum);
+            RC fileResult = file->async ? transferFramesAsync(owner, file, &refs[start], end - start, true)
+                    : writeFrames(&refs[start], end - start);
+            if (fileResult != RC_OK)
+                result = fileResult;
+        }
+        return result;
+    }
+
+    int numThreads = (owner->numFlushThreads < numRefs) ? owner->numFlushThreads : numRefs;
+    if (numThreads <= 1)
+        return writeFrames(refs, numRefs);
+
+    // give every thread an equal share of the sorted frames
+    RC result = RC_OK;
+    BM_FlushTask *tasks = malloc(numThreads * sizeof(BM_FlushTask));
+    for (int t = 0; t < numThreads; t++)
+    {
+        int start = (int)((long)numRefs * t / numThreads);
+        int end = (int)((long)numRefs * (t + 1) / numThreads);
+        tasks[t].refs = refs + start;
+        tasks[t].numRefs = end - start;
+        tasks[t].started = pthread_create(&(tasks[t].thread), NULL, runFlush, &(tasks[t])) == 0;
+
+        // a share whose thread could not be started is written by the calling thread
+        if (!tasks[t].started)
+            runFlush(&(tasks[t]));
+    }
+    for (int t = 0; t < numThreads; t++)
+    {
+        if (tasks[t].started)
+            pthread_join(tasks[t].thread, NULL);
+        if (tasks[t].result != RC_OK)
+            result = tasks[t].result;
+    }
+    free(tasks);
+    return result;
+}
+
+void *runFlush(void *arg)
+{
+    BM_FlushTask *task = (BM_FlushTask *)arg;
+    task->result = writeFrames(task->refs, task->numRefs);
+    return NULL;
+}
+
+RC writeFrames(BM_FrameRef *refs, int numRefs)
+{
+    RC result = RC_OK;
+    char **pages = malloc(numRefs * sizeof(char *));
+
+    for (int start = 0, end; start < numRefs; start = end)
+    {
+        BM_Metadata *owner = ((BM_Metadata *)refs[start].pool->mgmtData)->owner;
+        BM_File *file = fileOf(owner, refs[start].frame->pageNum);
+
+        // collect the run of consecutive pages starting at refs[start] (a run never leaves
+        // its file, the file id is in the high bits of the page number)
+        pages[0] = refs[start].frame->data;
+        for (end = start + 1; end < numRefs && refs[end].frame->pageNum == refs[end - 1].frame->pageNum + 1; end++)
+            pages[end - start] = refs[end].frame->data;
+
+        // resident pages are inside the file, so the file latch is only taken shared and the 
+        // vectored writes of several flush threads run at the same time
+        if (owner->concurrent)
+            pthread_rwlock_rdlock(&(file->fileLatch));
+        RC runResult = writeBlocks(PAGE_IN_FILE(refs[start].frame->pageNum), end - start, &(file->pageFile), pages);
+        if (owner->concurrent)
+            pthread_rwlock_unlock(&(file->fileLatch));
+        if (runResult != RC_OK)
+            result = runResult;
+
+        // the I/O is still counted per page, the pages of a failed run were cleaned before the
+        // write and are dirtied again so they are not lost
+        for (int i = start; i < end; i++)
+        {
+            BM_Metadata *metadata = (BM_Metadata *)refs[i].pool->mgmtData;
+            __atomic_add_fetch(&(metadata->numWrite), 1, __ATOMIC_RELAXED);
+            refs[i].result = runResult;
+            if (runResult != RC_OK)
+                setDirty(metadata, refs[i].frame);
+        }
+    }
+
+    free(pages);
+    return result;
+}
+
+RC transferFramesAsync(BM_Metadata *owner, BM_File *file, BM_FrameRef *refs, int numRefs, bool write)
+{
+    SM_AsyncIO *aio = &(file->asyncIO);
+    if (numRefs == 0)
+        return RC_OK;
+
+    // reads may have to grow the file up to their last page (the pages it grows by are 
+    // zeroed instead of read), either way the file latch is held shared while the runs are
+    // in flight
+    RC result = RC_OK;
+    int numTransfers = numRefs;
+    if (!write)
+    {
+        PageNumber oldNumPages;
+        result = growFile(owner, file, PAGE_IN_FILE(refs[numRefs - 1].frame->pageNum) + 1, &oldNumPages);
+        if (result == RC_OK)
+            numTransfers = zeroNewFrames(refs, numRefs, oldNumPages);
+    }
+    else if (owner->concurrent)
+        pthread_rwlock_rdlock(&(file->fileLatch));
+    for (int i = 0; i < numRefs; i++)
+        refs[i].result = result;
+
+    if (result == RC_OK)
+    {
+        // each run is submitted with its start as user data, runEnds maps it to its end
+        char **pages = malloc(numRefs * sizeof(char *));
+        int *runEnds = malloc(numRefs * sizeof(int));
+        SM_Completion *completions = malloc(aio->queueDepth * sizeof(SM_Completion));
+        if (owner->concurrent)
+            pthread_mutex_lock(&(file->asyncLatch));
+
+        int start = 0;
+        bool broken = file->asyncStalled;
+        long long deadline = 0;
+        while (start < numTransfers || (aio->inFlight > 0 && !file->asyncStalled))
+        {
+            // submit the run of consecutive pages starting at refs[start] while the queue has 
+            // room for it, once the queue is broken the rest of the runs are done synchronously
+            if (start < numTransfers && (broken || aio->inFlight < aio->queueDepth))
+            {
+                int end;
+                pages[0] = refs[start].frame->data;
+                for (end = start + 1; end < numTransfers && end - start < MAX_IO_VECTORS 
+                        && refs[end].frame->pageNum == refs[end - 1].frame->pageNum + 1; end++)
+                    pages[end - start] = refs[end].frame->data;
+                PageNumber localPage = PAGE_IN_FILE(refs[start].frame->pageNum);
+                int runStart = start;
+                RC runResult = RC_WRITE_FAILED;
+                runEnds[runStart] = end;
+                start = end;
+                if (!broken)
+                    runResult = write ? submitWriteBlocks(aio, localPage, end - runStart, pages, (void *)(intptr_t)runStart)
+                            : submitReadBlocks(aio, localPage, end - runStart, pages, (void *)(intptr_t)runStart);
+
+                // a queued run fails unless its completion says otherwise
+                if (runResult == RC_OK)
+                {
+                    for (int i = runStart; i < end; i++)
+                        refs[i].result = write ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+                    continue;
+                }
+
+                // a run that can not be queued is transferred synchronously instead
+                runResult = write ? writeBlocks(localPage, end - runStart, &(file->pageFile), pages)
+                        : readBlocks(localPage, end - runStart, &(file->pageFile), pages);
+                for (int i = runStart; i < end; i++)
+                    refs[i].result = runResult;
+                if (runResult != RC_OK)
+                    result = runResult;
+                continue;
+            }
+
+            // otherwise wait for at least one run to finish (none means the queue is broken), 
+            // the runs still in flight are polled for since their frames must not be released 
+            // before the kernel is done with them, but once none has finished for 
+            // ASYNC_DRAIN_TIMEOUT_MS they fail and the queue is not used again (so its late 
+            // completions are never reaped)
+            int numReaped = reapBlocks(aio, completions, broken ? 0 : 1, aio->queueDepth);
+            if (broken || numReaped == 0)
+            {
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                long long nowMs = (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+                if (numReaped > 0 || !broken)
+                    deadline = nowMs + ASYNC_DRAIN_TIMEOUT_MS;
+                else if (nowMs >= deadline)
+                {
+                    file->asyncStalled = true;
+                    result = write ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+                }
+                else
+                {
+                    struct timespec pollInterval = {0, 1000000};
+                    nanosleep(&pollInterval, NULL);
+                }
+                broken = true;
+            }
+            for (int i = 0; i < numReaped; i++)
+            {
+                int runStart = (intptr_t)completions[i].userData;
+                for (int j = runStart; j < runEnds[runStart]; j++)
+                    refs[j].result = completions[i].result;
+                if (completions[i].result != RC_OK)
+                    result = completions[i].result;
+            }
+        }
+
+        if (owner->concurrent)
+            pthread_mutex_unlock(&(file->asyncLatch));
+        free(completions);
+        free(runEnds);
+        free(pages);
+    }
+    if (owner->concurrent)
+        pthread_rwlock_unlock(&(file->fileLatch));
+
+    // the I/O is still counted per page, the pages of a failed write run were cleaned before 
+    // the write and are dirtied again so they are not lost
+    for (int i = 0; i < numRefs; i++)
+    {
+        BM_Metadata *metadata = (BM_Metadata *)refs[i].pool->mgmtData;
+        __atomic_add_fetch(write ? &(metadata->numWrite) : &(metadata->numRead), 1, __ATOMIC_RELAXED);
+        if (write && refs[i].result != RC_OK)
+            setDirty(metadata, refs[i].frame);
+    }
+    return result;
+}
+
+int compareFrameRefs(const void *refA, const void *refB)
+{
+    PageNumber pageA = ((const BM_FrameRef *)refA)->frame->pageNum;
+    PageNumber pageB = ((const BM_FrameRef *)refB)->frame->pageNum;
+    return (pageA > pageB) - (pageA < pageB);
+}
+
+RC writeFrame(BM_Metadata *metadata, BM_PageFrame *frame)
+{
+    BM_Metadata *owner = metadata->owner;
+    BM_File *file = fileOf(owner, frame->pageNum);
+    if (owner->concurrent)
+        pthread_rwlock_rdlock(&(file->fileLatch));
+    RC result = writeBlock(PAGE_IN_FILE(frame->pageNum), &(file->pageFile), frame->data);
+    if (owner->concurrent)
+        pthread_rwlock_unlock(&(file->fileLatch));
+    __atomic_add_fetch(&(metadata->numWrite), 1, __ATOMIC_RELAXED);
+    return result;
+}
+
+void latchTable(BM_Metadata *metadata)
+{
+    if (metadata->concurrent)
+        pthread_mutex_lock(&(metadata->tableLatch));
+}
+
+void unlatchTable(BM_Metadata *metadata)
+{
+    if (metadata->concurrent)
+        pthread_mutex_unlock(&(metadata->tableLatch));
+}
+
+void latchPolicy(BM_Metadata *metadata)
+{
+    if (metadata->concurrent)
+        pthread_mutex_lock(&(metadata->policyLatch));
+}
+
+void unlatchPolicy(BM_Metadata *metadata)
+{
+    if (metadata->concurrent)
+        pthread_mutex_unlock(&(metadata->policyLatch));
+}
+
+void latchFrame(BM_Metadata *metadata, BM_PageFrame *frame)
+{
+    if (metadata->concurrent)
+        pthread_mutex_lock(&(frame->latch));
+}
+
+void unlatchFrame(BM_Metadata *metadata, BM_PageFrame *frame)
+{
+    if (metadata->concurrent)
+        pthread_mutex_unlock(&(frame->latch));
+}
+
+void latchFiles(BM_Metadata *metadata)
+{
+    if (metadata->concurrent)
+        pthread_rwlock_rdlock(&(metadata->owner->filesLatch));
+}
+
+void unlatchFiles(BM_Metadata *metadata)
+{
+    if (metadata->concurrent)
+        pthread_rwlock_unlock(&(metadata->owner->filesLatch));
+}
@@ -13,13 +13,31 @@ typedef enum ReplacementStrategy {
 	RS_LRU = 1,
 	RS_CLOCK = 2,
 	RS_LFU = 3,
-	RS_LRU_K = 4
+	RS_LRU_K = 4,
+	RS_ARC = 5
 } ReplacementStrategy;
 
+// Backing of the frame memory
+typedef enum HugePages {
+	HP_NONE = 0,
+	HP_TRANSPARENT = 1, // transparent huge pages where the kernel has them
+	HP_EXPLICIT = 2 // reserved huge pages, falls back to transparent ones
+} HugePages;
+
 // Data Types and Structures
-typedef int PageNumber;
+// page numbers are 64-bit, so page files may be larger than 2 GB
+typedef long long PageNumber;
 #define NO_PAGE -1
 
+// a pool serves the pages of several page files: the page number a pool works with holds the
+// id of the file (see registerPageFile, the pool's own file has id 0) above FILE_PAGE_BITS 
+// and the page's number in that file below, so the pages of the pool's own file keep their
+// page numbers
+#define FILE_PAGE_BITS 48
+#define MAKE_FILE_PAGE(fileId, pageNum) (((PageNumber)(fileId) << FILE_PAGE_BITS) | (PageNumber)(pageNum))
+#define PAGE_FILE_ID(page) ((int)((page) >> FILE_PAGE_BITS))
+#define PAGE_IN_FILE(page) ((page) & (((PageNumber)1 << FILE_PAGE_BITS) - 1))
+
 typedef struct BM_BufferPool {
 	char *pageFile;
 	int numPages;
@@ -28,6 +46,55 @@ typedef struct BM_BufferPool {
 	// manager needs for a buffer pool
 } BM_BufferPool;
 
+// optional pool settings, a zeroed struct gives the defaults
+typedef struct BM_PoolOptions {
+	// memory budget in bytes of the TinyLFU frequency sketch, 0 disables admission
+	int admissionSketchBytes;
+	// make the pool safe to use from several threads at once
+	bool concurrent;
+	// split the frames into this many independent partitions selected by page number,
+	// 0 or 1 keeps a single partition
+	int numPartitions;
+	// run a background writer thread that writes dirty, unpinned frames near the eviction end
+	// of the replacement order (this makes the pool concurrent)
+	bool backgroundWriter;
+	// the writer wakes up every writerIntervalMs milliseconds and writes up to 
+	// writerPagesPerRound pages per partition, 0 picks the defaults
+	int writerIntervalMs;
+	int writerPagesPerRound;
+	// it starts writing once dirtyHighWatermark percent of a partition's frames are dirty and
+	// stops at dirtyLowWatermark percent, 0 picks the defaults
+	int dirtyHighWatermark;
+	int dirtyLowWatermark;
+	// number of I/O threads that read the pages passed to prefetchPages (this makes the pool 
+	// concurrent), without any prefetchPages reads them before it returns
+	int prefetchThreads;
+	// number of I/O threads that write the dirty pages in forceFlushPool and 
+	// shutdownBufferPool, 0 or 1 writes them in the calling thread
+	int flushThreads;
+	// number of page runs the reads of pinPages and the writes of forceFlushPool and 
+	// shutdownBufferPool keep in flight at once through an io_uring (or I/O threads where 
+	// there is none), 0 transfers one run at a time in the calling thread (or flush threads)
+	int ioQueueDepth;
+	// open the page file with O_DIRECT, so pages are only cached in the pool and not in the 
+	// kernel page cache as well (the frames are page aligned already)
+	bool directIO;
+	// map the page file read-only and let pins point into the mapping instead of reading
+	// pages into frames, pages past the end of the file cannot be pinned and markDirty and 
+	// forcePage fail
+	bool readOnlyMapping;
+	// reserve disk space for the pages the pool adds to the file this many pages at a time, 0
+	// leaves the added pages sparse until they are written
+	int preallocatePages;
+	// the frames are carved from one page-aligned memory arena, this picks the page size 
+	// backing it
+	HugePages hugePages;
+	// the most frames resizeBufferPool may grow the pool to (their records are allocated and
+	// their memory reserved up front), 0 keeps it at numPages, so a pool set up with 
+	// initBufferPool or without this option can shrink but never grow past its initial size
+	int maxPages;
+} BM_PoolOptions;
+
 typedef struct BM_PageHandle {
 	PageNumber pageNum;
 	char *data;
@@ -44,8 +111,19 @@ typedef struct BM_PageHandle {
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		const int numPages, ReplacementStrategy strategy,
 		void *stratData);
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName, 
+		const int numPages, ReplacementStrategy strategy,
+		void *stratData, const BM_PoolOptions *options);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+RC resizeBufferPool(BM_BufferPool *const bm, const int numPages);
+
+// Buffer Manager Interface Page Files
+// in a concurrent pool unregisterPageFile waits for the reads, writes and flushes in progress, 
+// but a page of the file must not be pinned by another thread while it is unregistered
+RC registerPageFile(BM_BufferPool *const bm, const char *const pageFileName, int *fileId);
+RC unregisterPageFile(BM_BufferPool *const bm, const int fileId);
+RC forceFlushFile(BM_BufferPool *const bm, const int fileId);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -53,12 +131,18 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
+RC pinPages (BM_BufferPool *const bm, const PageNumber *pageNums, 
+		BM_PageHandle *handles, const int n);
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber *pages, 
+		const int count);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
 bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
-int getNumReadIO (BM_BufferPool *const bm);
-int getNumWriteIO (BM_BufferPool *const bm);
+long long getNumReadIO (BM_BufferPool *const bm);
+long long getNumWriteIO (BM_BufferPool *const bm);
+// the size of the pool's frames, which is the page size of its page file
+int getPageSize (BM_BufferPool *const bm);
 
 #endif
@@ -25,7 +25,7 @@ printPoolContent (BM_BufferPool *const bm)
 	printf(" %i}: ", bm->numPages);
 
 	for (i = 0; i < bm->numPages; i++)
-		printf("%s[%i%s%i]", ((i == 0) ? "" : ",") , frameContent[i], (dirty[i] ? "x": " "), fixCount[i]);
+		printf("%s[%lld%s%i]", ((i == 0) ? "" : ",") , frameContent[i], (dirty[i] ? "x": " "), fixCount[i]);
 	printf("\n");
 }
 
@@ -39,13 +39,13 @@ sprintPoolContent (BM_BufferPool *const bm)
 	char *message;
 	int pos = 0;
 
-	message = (char *) malloc(256 + (22 * bm->numPages));
+	message = (char *) malloc(256 + (40 * bm->numPages));
 	frameContent = getFrameContents(bm);
 	dirty = getDirtyFlags(bm);
 	fixCount = getFixCounts(bm);
 
 	for (i = 0; i < bm->numPages; i++)
-		pos += sprintf(message + pos, "%s[%i%s%i]", ((i == 0) ? "" : ",") , frameContent[i], (dirty[i] ? "x": " "), fixCount[i]);
+		pos += sprintf(message + pos, "%s[%lld%s%i]", ((i == 0) ? "" : ",") , frameContent[i], (dirty[i] ? "x": " "), fixCount[i]);
 
 	return message;
 }
@@ -56,7 +56,7 @@ printPageContent (BM_PageHandle *const page)
 {
 	int i;
 
-	printf("[Page %i]\n", page->pageNum);
+	printf("[Page %lld]\n", page->pageNum);
 
 	for (i = 1; i <= PAGE_SIZE; i++)
 		printf("%02X%s%s", page->data[i], (i % 8) ? "" : " ", (i % 64) ? "" : "\n");
@@ -70,7 +70,7 @@ sprintPageContent (BM_PageHandle *const page)
 	int pos = 0;
 
 	message = (char *) malloc(30 + (2 * PAGE_SIZE) + (PAGE_SIZE % 64) + (PAGE_SIZE % 8));
-	pos += sprintf(message + pos, "[Page %i]\n", page->pageNum);
+	pos += sprintf(message + pos, "[Page %lld]\n", page->pageNum);
 
 	for (i = 1; i <= PAGE_SIZE; i++)
 		pos += sprintf(message + pos, "%02X%s%s", page->data[i], (i % 8) ? "" : " ", (i % 64) ? "" : "\n");
@@ -98,6 +98,9 @@ printStrat (BM_BufferPool *const bm)
 	case RS_LRU_K:
 		printf("LRU-K");
 		break;
+	case RS_ARC:
+		printf("ARC");
+		break;
 	default:
 		printf("%i", bm->strategy);
 		break;
@@ -0,0 +1,83 @@
+#include "freq_sketch.h"
+#include <stdlib.h>
+
+// a count-min sketch with one row of counters per hash function
+#define SKETCH_DEPTH 4
+#define SKETCH_MIN_WIDTH 16
+
+// counters saturate at this value, they only need to tell warm from hot
+#define SKETCH_MAX_COUNT 15
+
+// all counters are halved after this many increments per column
+#define SKETCH_SAMPLE_FACTOR 10
+
+static const unsigned long long SKETCH_SEEDS[SKETCH_DEPTH] = {
+    0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0x27D4EB2F165667C5ULL
+};
+
+int SK_index(FS_SketchHandle *const fs, int row, long long key)
+{
+    // mix the key with the row's seed (splitmix64 finalizer)
+    unsigned long long h = (unsigned long long)key + SKETCH_SEEDS[row];
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return row * fs->width + (int)(h & (fs->width - 1));
+}
+
+void SK_halve(FS_SketchHandle *const fs)
+{
+    unsigned char *counters = (unsigned char *)fs->mgmt;
+    for (int i = 0; i < SKETCH_DEPTH * fs->width; i++)
+        counters[i] >>= 1;
+    fs->samples /= 2;
+}
+
+// size the sketch to the largest power of two width that fits into bytes
+int initSketch(FS_SketchHandle *const fs, int bytes)
+{
+    int width = SKETCH_MIN_WIDTH;
+    while (width * 2 * SKETCH_DEPTH <= bytes)
+        width *= 2;
+    fs->width = width;
+    fs->samples = 0;
+    fs->sampleSize = SKETCH_SAMPLE_FACTOR * width;
+    fs->mgmt = calloc(SKETCH_DEPTH * width, sizeof(unsigned char));
+    if (fs->mgmt == NULL)
+        return 1;
+    return 0;
+}
+
+// record an access to key, halving all counters once enough accesses were sampled
+void incrementFrequency(FS_SketchHandle *const fs, long long key)
+{
+    unsigned char *counters = (unsigned char *)fs->mgmt;
+    for (int row = 0; row < SKETCH_DEPTH; row++)
+    {
+        int i = SK_index(fs, row, key);
+        if (counters[i] < SKETCH_MAX_COUNT)
+            counters[i]++;
+    }
+    if (++fs->samples >= fs->sampleSize)
+        SK_halve(fs);
+}
+
+// the estimate is the smallest counter of key over all rows
+int estimateFrequency(FS_SketchHandle *const fs, long long key)
+{
+    unsigned char *counters = (unsigned char *)fs->mgmt;
+    int estimate = SKETCH_MAX_COUNT;
+    for (int row = 0; row < SKETCH_DEPTH; row++)
+    {
+        int i = SK_index(fs, row, key);
+        if (counters[i] < estimate)
+            estimate = counters[i];
+    }
+    return estimate;
+}
+
+// free malloc's
+void freeSketch(FS_SketchHandle *const fs)
+{
+    free(fs->mgmt);
+}
@@ -0,0 +1,16 @@
+#ifndef FREQ_SKETCH_H
+#define FREQ_SKETCH_H
+
+typedef struct FS_SketchHandle {
+    int width;
+    int samples;
+    int sampleSize;
+    void *mgmt;
+} FS_SketchHandle;
+
+int initSketch(FS_SketchHandle *const fs, int bytes);
+void incrementFrequency(FS_SketchHandle *const fs, long long key);
+int estimateFrequency(FS_SketchHandle *const fs, long long key);
+void freeSketch(FS_SketchHandle *const fs);
+
+#endif
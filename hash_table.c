@@ -1,123 +1,313 @@
 #include "hash_table.h"
 #include <stdlib.h>
+#include <stdbool.h>
 
-#define ARRAY_LIST_SIZE 16
+// the table grows once more than 3/4 of its slots are used
+#define MAX_LOAD_NUMERATOR 3
+#define MAX_LOAD_DENOMINATOR 4
 
-typedef struct HT_KeyValuePair {
-    int key;
+// distance of an empty slot
+#define EMPTY_SLOT -1
+
+// a concurrent table has one version counter per stripe of 1 << STRIPE_BITS slots
+#define STRIPE_BITS 6
+
+// a slot holds a pair and how far it was placed from its home slot (the slot its key
+// hashes to)
+typedef struct HT_Slot {
+    long long key;
     int value;
-} HT_KeyValuePair;
+    int distance;
+} HT_Slot;
 
-typedef struct HT_ArrayList {
-    int capacity;
-    int size;
-    HT_KeyValuePair *list;
-} HT_ArrayList;
+// an open-addressing table with Robin Hood probing: a key is placed in the first free slot
+// after its home slot, but it takes over any slot whose key is closer to its own home, so
+// lookups can stop as soon as they reach a slot closer to its home than the key would be
+//
+// in a concurrent table the writer makes the version of every stripe it changes odd before
+// the first change and even again once it is done, readers retry if a stripe they looked at
+// was odd or changed its version meanwhile (a seqlock per stripe)
+typedef struct HT_Map {
+    int mask;
+    int count;
+    HT_Slot *slots;
+    bool concurrent;
+    unsigned int *versions;
+    // the stripes the current write changed so far, a write changes consecutive slots
+    int firstStripe;
+    int numStripes;
+} HT_Map;
 
-HT_ArrayList *AL_get(HT_TableHandle *const ht, int i)
+// mix all bits of the key into the slot index (the finalizer of MurmurHash3), consecutive
+// page numbers would otherwise fill runs of neighbouring slots, the high half of a 64-bit key
+// is folded in first so keys below 2^32 cost no more than 32-bit ones
+unsigned int HT_hash(long long key)
 {
-    HT_ArrayList *ls = (HT_ArrayList *)ht->mgmt;
-    return &ls[i];
+    unsigned int h = (unsigned int)key ^ (unsigned int)((unsigned long long)key >> 32);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
 }
 
-int AL_push(HT_ArrayList *al, int key, int value)
+// allocate numSlots (a power of two) empty slots
+int HT_alloc(HT_TableHandle *const ht, int numSlots)
 {
-    if (al->size == al->capacity)
+    HT_Map *map = (HT_Map *)ht->mgmt;
+    map->slots = malloc(sizeof(HT_Slot) * numSlots);
+    if (map->slots == NULL)
+        return 1;
+
+    // concurrent readers may look at the key and value of an empty slot before they notice
+    // a write, so they start out as valid values
+    for (int i = 0; i < numSlots; i++)
     {
-        al->capacity += ARRAY_LIST_SIZE;
-        al->list = realloc(al->list, sizeof(HT_KeyValuePair) * al->capacity);
-        if (al->list == NULL)
-            return 1;
+        map->slots[i].key = 0;
+        map->slots[i].value = 0;
+        map->slots[i].distance = EMPTY_SLOT;
     }
-    al->list[al->size].key = key;
-    al->list[al->size].value = value;
-    al->size++;
+    map->mask = numSlots - 1;
+    map->count = 0;
+    ht->size = numSlots;
     return 0;
 }
 
-void AL_remoteAt(HT_ArrayList *al, int i)
+// store a slot, in a concurrent table the first store to a stripe makes its version odd
+void HT_store(HT_Map *map, int i, HT_Slot slot)
 {
-    if (i >= 0 && i < al->size) {
-        for (int j = i; j < al->size - 1; j++)
-            al->list[j] = al->list[j + 1];
-        al->size--;
+    if (map->concurrent)
+    {
+        int stripe = i >> STRIPE_BITS;
+        int lastStripe = (map->firstStripe + map->numStripes - 1) & (map->mask >> STRIPE_BITS);
+        if (map->numStripes == 0 || stripe != lastStripe)
+        {
+            if (map->numStripes == 0)
+                map->firstStripe = stripe;
+            map->numStripes++;
+            __atomic_store_n(&(map->versions[stripe]), map->versions[stripe] + 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&(map->slots[i].key), slot.key, __ATOMIC_RELAXED);
+        __atomic_store_n(&(map->slots[i].value), slot.value, __ATOMIC_RELAXED);
+        __atomic_store_n(&(map->slots[i].distance), slot.distance, __ATOMIC_RELAXED);
     }
+    else map->slots[i] = slot;
 }
 
-// initialize hash table
-int initHashTable(HT_TableHandle *const ht, int size) 
+// make the versions of the stripes the write changed even again
+void HT_publish(HT_Map *map)
 {
-    ht->size = size;
-    ht->mgmt = malloc(sizeof(HT_ArrayList) * size);
-    for (int i = 0; i < size; i++)
+    for (int s = 0; s < map->numStripes; s++)
     {
-        HT_ArrayList *al = AL_get(ht, i);
-        al->list = malloc(sizeof(HT_KeyValuePair) * ARRAY_LIST_SIZE);
-        if (al->list == NULL)
-            return 1;
-        al->capacity = ARRAY_LIST_SIZE;
-        al->size = 0;
+        int stripe = (map->firstStripe + s) & (map->mask >> STRIPE_BITS);
+        __atomic_store_n(&(map->versions[stripe]), map->versions[stripe] + 1, __ATOMIC_RELEASE);
     }
-    return 0;
+    map->numStripes = 0;
 }
 
-// if the key is found then assign to value and return 0
-// else return 1
-int getValue(HT_TableHandle *const ht, int key, int *value) 
+// place a key that is not in the table yet
+void HT_insert(HT_Map *map, long long key, int value)
 {
-    int i = key % ht->size;
-    HT_ArrayList *al  = AL_get(ht, i);
-    for (int j = 0; j < al->size; j++)
+    HT_Slot carry = {key, value, 0};
+    int i = HT_hash(key) & map->mask;
+    while (map->slots[i].distance != EMPTY_SLOT)
     {
-        if (al->list[j].key == key)
+        // take the slot of a key that is closer to its home and move that key on instead
+        if (map->slots[i].distance < carry.distance)
         {
-            *value = al->list[j].value;
-            return 0;
+            HT_Slot displaced = map->slots[i];
+            HT_store(map, i, carry);
+            carry = displaced;
         }
+        i = (i + 1) & map->mask;
+        carry.distance++;
     }
-    return 1;
+    HT_store(map, i, carry);
+    map->count++;
 }
 
-// if the key exists, then assign value to it
-// else, add in a new HT_KeyValuePair
-int setValue(HT_TableHandle *const ht, int key, int value) 
+// return the slot holding key, or -1
+int HT_find(HT_Map *map, long long key)
 {
-    int i = key % ht->size;
-    HT_ArrayList *al  = AL_get(ht, i);
-    for (int j = 0; j < al->size; j++)
+    int i = HT_hash(key) & map->mask;
+    for (int distance = 0; map->slots[i].distance >= distance; distance++)
     {
-        if (al->list[j].key == key)
-        {
-            al->list[j].value = value;
-            return 0;
-        }
+        if (map->slots[i].key == key)
+            return i;
+        i = (i + 1) & map->mask;
     }
-    return AL_push(al, key, value);
+    return -1;
 }
 
-// remove a HT_KeyValuePair 
-int removePair(HT_TableHandle *const ht, int key) 
+// look key up without locks in a concurrent table, like HT_find it returns whether it found
+// the key
+bool HT_read(HT_Map *map, long long key, int *value)
 {
-    int i = key % ht->size;
-    HT_ArrayList *al  = AL_get(ht, i);
-    for (int j = 0; j < al->size; j++)
+    int home = HT_hash(key) & map->mask;
+    while (true)
     {
-        if (al->list[j].key == key)
+        // the versions of the stripes the probe enters are added up, as versions only grow
+        // the sum only stays the same if none of them changed
+        int i = home;
+        int stripe = i >> STRIPE_BITS;
+        unsigned int version = __atomic_load_n(&(map->versions[stripe]), __ATOMIC_ACQUIRE);
+        unsigned int sum = version;
+        bool odd = version & 1;
+        bool found = false;
+        int numStripes = 1;
+        for (int distance = 0; !odd; distance++)
+        {
+            if (__atomic_load_n(&(map->slots[i].distance), __ATOMIC_RELAXED) < distance)
+                break;
+            if (__atomic_load_n(&(map->slots[i].key), __ATOMIC_RELAXED) == key)
+            {
+                *value = __atomic_load_n(&(map->slots[i].value), __ATOMIC_RELAXED);
+                found = true;
+                break;
+            }
+            i = (i + 1) & map->mask;
+            if ((i >> STRIPE_BITS) != stripe)
+            {
+                stripe = i >> STRIPE_BITS;
+                version = __atomic_load_n(&(map->versions[stripe]), __ATOMIC_ACQUIRE);
+                sum += version;
+                odd = version & 1;
+                numStripes++;
+            }
+        }
+
+        // check that no stripe was written while it was read
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        stripe = home >> STRIPE_BITS;
+        for (int s = 0; s < numStripes; s++)
         {
-            AL_remoteAt(al, j);
-            return 0;
+            sum -= __atomic_load_n(&(map->versions[stripe]), __ATOMIC_RELAXED);
+            stripe = (stripe + 1) & (map->mask >> STRIPE_BITS);
         }
+        if (!odd && sum == 0)
+            return found;
     }
-    return 1;
 }
 
-// free malloc's
-void freeHashTable(HT_TableHandle *const ht)
+// double the number of slots and place all pairs again
+int HT_grow(HT_TableHandle *const ht)
 {
-    for (int i = 0; i < ht->size; i++)
+    HT_Map *map = (HT_Map *)ht->mgmt;
+    HT_Slot *slots = map->slots;
+    int numSlots = map->mask + 1;
+
+    if (HT_alloc(ht, numSlots * 2) == 1)
     {
-        HT_ArrayList *al = AL_get(ht, i);
-        free(al->list);
+        map->slots = slots;
+        map->mask = numSlots - 1;
+        return 1;
     }
-    free(ht->mgmt);
-}
\ No newline at end of file
+    for (int i = 0; i < numSlots; i++)
+    {
+        if (slots[i].distance != EMPTY_SLOT)
+            HT_insert(map, slots[i].key, slots[i].value);
+    }
+    free(slots);
+    return 0;
+}
+
+// initialize hash table, size is the number of pairs it holds without growing
+int initHashTable(HT_TableHandle *const ht, int size)
+{
+    int numSlots = 1;
+    while (numSlots * MAX_LOAD_NUMERATOR < size * MAX_LOAD_DENOMINATOR)
+        numSlots *= 2;
+
+    ht->mgmt = malloc(sizeof(HT_Map));
+    if (ht->mgmt == NULL)
+        return 1;
+    ((HT_Map *)ht->mgmt)->concurrent = false;
+    ((HT_Map *)ht->mgmt)->versions = NULL;
+    ((HT_Map *)ht->mgmt)->numStripes = 0;
+    return HT_alloc(ht, numSlots);
+}
+
+// initialize a concurrent hash table, it has at least one stripe
+int initConcurrentHashTable(HT_TableHandle *const ht, int size)
+{
+    if (size < (1 << STRIPE_BITS))
+        size = 1 << STRIPE_BITS;
+    if (initHashTable(ht, size) == 1)
+        return 1;
+
+    HT_Map *map = (HT_Map *)ht->mgmt;
+    map->concurrent = true;
+    map->versions = calloc(ht->size >> STRIPE_BITS, sizeof(unsigned int));
+    return (map->versions == NULL) ? 1 : 0;
+}
+
+// if the key is found then assign to value and return 0
+// else return 1
+int getValue(HT_TableHandle *const ht, long long key, int *value)
+{
+    HT_Map *map = (HT_Map *)ht->mgmt;
+    if (map->concurrent)
+        return HT_read(map, key, value) ? 0 : 1;
+    int i = HT_find(map, key);
+    if (i < 0)
+        return 1;
+    *value = map->slots[i].value;
+    return 0;
+}
+
+// if the key exists, then assign value to it
+// else, add in a new pair
+int setValue(HT_TableHandle *const ht, long long key, int value)
+{
+    HT_Map *map = (HT_Map *)ht->mgmt;
+    int i = HT_find(map, key);
+    if (i >= 0)
+    {
+        HT_Slot slot = map->slots[i];
+        slot.value = value;
+        HT_store(map, i, slot);
+        HT_publish(map);
+        return 0;
+    }
+
+    // readers of a concurrent table may still look at the old slots, so it does not grow
+    if ((map->count + 1) * MAX_LOAD_DENOMINATOR > (map->mask + 1) * MAX_LOAD_NUMERATOR 
+            && (map->concurrent || HT_grow(ht) == 1))
+        return 1;
+    HT_insert(map, key, value);
+    HT_publish(map);
+    return 0;
+}
+
+// remove a pair, the pairs after it that are not in their home slot move back by one so no
+// tombstone is left behind
+int removePair(HT_TableHandle *const ht, long long key)
+{
+    HT_Map *map = (HT_Map *)ht->mgmt;
+    int i = HT_find(map, key);
+    if (i < 0)
+        return 1;
+    for (int next = (i + 1) & map->mask; map->slots[next].distance > 0; next = (next + 1) & map->mask)
+    {
+        HT_Slot slot = map->slots[next];
+        slot.distance--;
+        HT_store(map, i, slot);
+        i = next;
+    }
+    HT_Slot empty = {0, 0, EMPTY_SLOT};
+    HT_store(map, i, empty);
+    map->count--;
+    HT_publish(map);
+    return 0;
+}
+
+// free malloc's
+void freeHashTable(HT_TableHandle *const ht)
+{
+    HT_Map *map = (HT_Map *)ht->mgmt;
+    free(map->slots);
+    free(map->versions);
+    free(map);
+}
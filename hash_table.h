@@ -4,7 +4,11 @@ typedef struct HT_TableHandle {
 } HT_TableHandle;
 
 int initHashTable(HT_TableHandle *const ht, int size);
-int getValue(HT_TableHandle *const ht, int key, int *value);
-int setValue(HT_TableHandle *const ht, int key, int value);
-int removePair(HT_TableHandle *const ht, int key);
+// a concurrent table never grows beyond size pairs, getValue may run in any number of threads
+// without locks while one thread at a time calls setValue or removePair
+int initConcurrentHashTable(HT_TableHandle *const ht, int size);
+// keys are 64-bit page numbers
+int getValue(HT_TableHandle *const ht, long long key, int *value);
+int setValue(HT_TableHandle *const ht, long long key, int value);
+int removePair(HT_TableHandle *const ht, long long key);
 void freeHashTable(HT_TableHandle *const ht);
\ No newline at end of file
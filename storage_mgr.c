@@ -1,75 +1,299 @@
+// for O_DIRECT, and a 64-bit off_t where it is not the default
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
 #include "storage_mgr.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <linux/io_uring.h>
+
+// the most I/O threads the thread engine starts
+#define MAX_ASYNC_THREADS 64
+
+// end of the request lists of the asynchronous engines
+#define NO_REQUEST -1
+
+// a page file starts with a header block of one page that records the page size, the pages
+// follow it so they stay aligned for direct I/O and mappings (files without the magic are
+// headerless files of PAGE_SIZE pages)
+#define FILE_MAGIC "PAGEFILE"
+
+typedef struct SM_FileHeader {
+    char magic[8];
+    int pageSize;
+} SM_FileHeader;
+
+// the file behind an open SM_FileHandle (stored in `mgmtInfo`), all I/O is positional so the
+// descriptor has no shared file position and threads may read and write different pages of 
+// the same handle at once
+typedef struct SM_FileInfo {
+    int fd;
+    // the size of the pages and the offset of the first one
+    int pageSize;
+    off_t dataOffset;
+    // the read-only mapping of a file opened with SM_OPEN_MAPPED (NULL otherwise)
+    char *mapping;
+    long long mappedPages;
+    // disk space is reserved preallocPages pages at a time (0 leaves the file sparse), and it
+    // is reserved for the first allocatedPages pages
+    int preallocPages;
+    long long allocatedPages;
+} SM_FileInfo;
+
+// an asynchronous request, iov holds its pages (one per vector) until it is reaped
+typedef struct SM_AsyncRequest {
+    void *userData;
+    struct iovec *iov;
+    int numVectors;
+    off_t offset;
+    int write;
+    RC result;
+    // the next request in the free list or in a queue of the thread engine
+    int next;
+} SM_AsyncRequest;
+
+// the state behind an SM_AsyncIO (stored in `mgmtInfo`), there is one request slot per 
+// request that may be in flight
+typedef struct SM_AsyncInfo {
+    SM_FileHandle *fHandle;
+    int fd;
+    SM_AsyncRequest *requests;
+    int freeRequests;
+
+    // the io_uring: its descriptor, the mapped rings and the number of queued submissions the
+    // kernel has not been told about yet
+    int ringFd;
+    void *sqRing;
+    void *cqRing;
+    size_t sqRingSize;
+    size_t cqRingSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+    int numUnsubmitted;
+
+    // the thread engine: its threads, the queue of submitted requests they take from and the 
+    // queue of finished ones reapBlocks takes from (the io_uring engine puts the requests it
+    // took back from the ring there)
+    pthread_t *threads;
+    int numThreads;
+    pthread_mutex_t latch;
+    pthread_cond_t submitted;
+    pthread_cond_t finished;
+    int queueHead;
+    int queueTail;
+    int doneHead;
+    int doneTail;
+    int numDone;
+    int stop;
+} SM_AsyncInfo;
 
 /* manipulating page files */
 
 void initStorageManager(void) { }
 
+// a page size is a power of two in the supported range
+bool _validPageSize(int pageSize)
+{
+    return pageSize >= MIN_PAGE_SIZE && pageSize <= MAX_PAGE_SIZE && (pageSize & (pageSize - 1)) == 0;
+}
+
 RC createPageFile(char *fileName)
 {
-    FILE *fp = fopen(fileName, "w+");
-    if (fp == NULL) return RC_FILE_NOT_FOUND;
-    else
-    {
-        // allocate a page of memory and fill the page with `\0` bytes
-        void *emptyPage = malloc(PAGE_SIZE); 
-        memset(emptyPage, '\0', PAGE_SIZE);
+    return createPageFileWithPageSize(fileName, PAGE_SIZE);
+}
 
-        // write the page to disk and close the file
-        size_t bytesWritten = fwrite(emptyPage, sizeof(char), PAGE_SIZE, fp);
-        fclose(fp);
-        free(emptyPage);
+RC createPageFileWithPageSize(char *fileName, int pageSize)
+{
+    if (!_validPageSize(pageSize))
+        return RC_INVALID_STRATEGY_DATA;
 
-        // make sure the page was entirely written
-        if (bytesWritten != PAGE_SIZE) return RC_WRITE_FAILED;
+    int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return RC_FILE_NOT_FOUND;
+    else
+    {
+        // allocate the header block and the first page and fill them with `\0` bytes
+        char *blocks = calloc(2, pageSize);
+        SM_FileHeader header;
+        memset(&header, '\0', sizeof(header));
+        memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+        header.pageSize = pageSize;
+        memcpy(blocks, &header, sizeof(header));
+
+        // write both to disk and close the file
+        ssize_t bytesWritten = pwrite(fd, blocks, 2 * (size_t)pageSize, 0);
+        close(fd);
+        free(blocks);
+
+        // make sure the blocks were entirely written
+        if (bytesWritten != 2 * (ssize_t)pageSize) return RC_WRITE_FAILED;
         else return RC_OK;
     }
 }
 
-long _getFileSize(FILE *file)
+// skip the first bytes of the remaining buffers of a vectored transfer, the buffers that 
+// were transferred entirely are dropped and a partial one is moved into
+void _skipVectors(struct iovec **next, int *remaining, size_t bytes)
+{
+    while (*remaining > 0 && bytes >= (*next)->iov_len)
+    {
+        bytes -= (*next)->iov_len;
+        (*next)++;
+        (*remaining)--;
+    }
+    if (*remaining > 0)
+    {
+        (*next)->iov_base = (char *)(*next)->iov_base + bytes;
+        (*next)->iov_len -= bytes;
+    }
+}
+
+// the offset of a page in the file, behind the header
+off_t _pageOffset(SM_FileInfo *info, long long pageNum)
+{
+    return info->dataOffset + (off_t)pageNum * info->pageSize;
+}
+
+// transfer the remaining buffers starting at offset, short transfers are continued
+RC _transferVectors(int fd, struct iovec *next, int remaining, off_t offset, int write)
 {
-    // move the file pointer to the end
-    fseek(file, 0L, SEEK_END); 
+    while (remaining > 0)
+    {
+        ssize_t bytes = write ? pwritev(fd, next, remaining, offset) : preadv(fd, next, remaining, offset);
+        if (bytes <= 0) return write ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        offset += bytes;
+        _skipVectors(&next, &remaining, bytes);
+    }
+    return RC_OK;
+}
 
-    // find the position of the file pointer from the start of the file
-    long size = ftell(file); 
+// read or write numPages consecutive pages starting at pageNum with as few vectored system 
+// calls as possible (at most MAX_IO_VECTORS pages each), short transfers are continued, and
+// several threads may transfer different pages of the same file at once
+RC _transferBlocks(SM_FileInfo *info, long long pageNum, int numPages, SM_PageHandle *memPages, int write)
+{
+    struct iovec iov[MAX_IO_VECTORS];
+    while (numPages > 0)
+    {
+        int count = (numPages < MAX_IO_VECTORS) ? numPages : MAX_IO_VECTORS;
+        for (int i = 0; i < count; i++)
+        {
+            iov[i].iov_base = memPages[i];
+            iov[i].iov_len = info->pageSize;
+        }
 
-     // move the file pointer back to the beginning
-    rewind(file);
-    return size;
+        RC result = _transferVectors(info->fd, iov, count, _pageOffset(info, pageNum), write);
+        if (result != RC_OK)
+            return result;
+        pageNum += count;
+        numPages -= count;
+        memPages += count;
+    }
+    return RC_OK;
 }
 
 RC openPageFile(char *fileName, SM_FileHandle *fHandle)
 {
-    FILE *fp = fopen(fileName, "r+");
+    return openPageFileWithFlags(fileName, fHandle, 0);
+}
 
-    if (fp == NULL) return RC_FILE_NOT_FOUND;
+RC openPageFileWithFlags(char *fileName, SM_FileHandle *fHandle, int flags)
+{
+    // with O_DIRECT the pages are transferred between the caller's buffers and the disk 
+    // without a copy in the kernel page cache
+    int fd = open(fileName, O_RDWR | ((flags & SM_OPEN_DIRECT) ? O_DIRECT : 0));
+    struct stat st;
+
+    if (fd < 0) return RC_FILE_NOT_FOUND;
+    else if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return RC_FILE_NOT_FOUND;
+    }
     else
     {
-        // get the size of the file and divide by page size to get `totalNumPages`
-        int size = _getFileSize(fp);
-        int totalNumPages = size / PAGE_SIZE;
+        SM_FileInfo *info = malloc(sizeof(SM_FileInfo));
+        info->fd = fd;
+
+        // the header tells the page size, the buffer is page aligned in case of O_DIRECT
+        SM_FileHeader *header = aligned_alloc(PAGE_SIZE, PAGE_SIZE);
+        ssize_t bytesRead = pread(fd, header, PAGE_SIZE, 0);
+        if (bytesRead >= (ssize_t)sizeof(SM_FileHeader) && memcmp(header->magic, FILE_MAGIC, sizeof(header->magic)) == 0)
+        {
+            info->pageSize = header->pageSize;
+            info->dataOffset = header->pageSize;
+        }
+        else
+        {
+            info->pageSize = PAGE_SIZE;
+            info->dataOffset = 0;
+        }
+        free(header);
+        if (!_validPageSize(info->pageSize))
+        {
+            free(info);
+            close(fd);
+            return RC_FILE_HANDLE_NOT_INIT;
+        }
+
+        // divide the size of the pages after the header by page size to get `totalNumPages`
+        long long totalNumPages = (st.st_size > info->dataOffset) ? (st.st_size - info->dataOffset) / info->pageSize : 0;
+
+        info->preallocPages = 0;
+        info->allocatedPages = totalNumPages;
+
+        // map the whole pages, pages appended later are not mapped
+        info->mapping = NULL;
+        info->mappedPages = 0;
+        if ((flags & SM_OPEN_MAPPED) && totalNumPages > 0)
+        {
+            info->mapping = mmap(NULL, (size_t)totalNumPages * info->pageSize, PROT_READ, MAP_SHARED, fd, info->dataOffset);
+            if (info->mapping == MAP_FAILED)
+            {
+                free(info);
+                close(fd);
+                return RC_FILE_NOT_FOUND;
+            }
+            info->mappedPages = totalNumPages;
+        }
         
         // set metadata
         fHandle->fileName = fileName;
         fHandle->totalNumPages = totalNumPages;
         fHandle->curPagePos = 0;
+        fHandle->pageSize = info->pageSize;
 
-        // store the file pointer in `mgmtInfo` to use else where
-        fHandle->mgmtInfo = (void *)fp;
+        // store the file info in `mgmtInfo` to use else where
+        fHandle->mgmtInfo = (void *)info;
         return RC_OK;
     }
 }
 
 RC closePageFile (SM_FileHandle *fHandle)
 {
-    if (fclose((FILE *)fHandle->mgmtInfo) == 0)
+    SM_FileInfo *info = (SM_FileInfo *)fHandle->mgmtInfo;
+    if (info->mapping != NULL)
+        munmap(info->mapping, (size_t)info->mappedPages * info->pageSize);
+    if (close(info->fd) == 0)
     {
-        // unset the file pointer
+        // unset the file info
+        free(info);
         fHandle->mgmtInfo = NULL;
         return RC_OK;
     }
@@ -84,26 +308,57 @@ RC destroyPageFile (char *fileName)
 
 /* reading blocks from disc */
 
-RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+RC readBlock (long long pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
     // check the handle to see if pageNum is in range
     if (pageNum < 0 || pageNum >= fHandle->totalNumPages) 
         return RC_READ_NON_EXISTING_PAGE;
-    FILE *fp = (FILE *)fHandle->mgmtInfo;
 
-    // check to see if the position was set successfully
-    if (fseek(fp, pageNum * PAGE_SIZE, SEEK_SET) == 0)
-    {
-        size_t bytesRead = fread(memPage, sizeof(char), PAGE_SIZE, fp);
+    // the page is read at its offset, short reads are continued
+    return _transferBlocks((SM_FileInfo *)fHandle->mgmtInfo, pageNum, 1, &memPage, 0);
+}
 
-        // make sure the page was entirely read
-        if (bytesRead != PAGE_SIZE) return RC_READ_NON_EXISTING_PAGE;
-        else return RC_OK;
-    }    
-    else return RC_FILE_NOT_FOUND;
+RC readBlocks (long long pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages)
+{
+    // check the handle to see if all pages are in range
+    if (pageNum < 0 || numPages < 0 || pageNum + numPages > fHandle->totalNumPages) 
+        return RC_READ_NON_EXISTING_PAGE;
+    return _transferBlocks((SM_FileInfo *)fHandle->mgmtInfo, pageNum, numPages, memPages, 0);
+}
+
+SM_PageHandle getMappedBlock (long long pageNum, SM_FileHandle *fHandle)
+{
+    // only pages inside the mapping of a mapped file have an address
+    SM_FileInfo *info = (SM_FileInfo *)fHandle->mgmtInfo;
+    if (pageNum < 0 || pageNum >= info->mappedPages)
+        return NULL;
+    return info->mapping + (size_t)pageNum * info->pageSize;
 }
 
-int getBlockPos (SM_FileHandle *fHandle)
+RC adviseBlocks (long long pageNum, long long numPages, SM_FileHandle *fHandle, SM_Advice advice)
+{
+    // check the handle to see if all pages are in range
+    if (pageNum < 0 || numPages < 0 || pageNum + numPages > fHandle->totalNumPages) 
+        return RC_READ_NON_EXISTING_PAGE;
+    if (advice < SM_ADVICE_NORMAL || advice > SM_ADVICE_WILLNEED)
+        return RC_INVALID_STRATEGY_DATA;
+
+    // the mapped pages are advised through the mapping, the others through the file
+    SM_FileInfo *info = (SM_FileInfo *)fHandle->mgmtInfo;
+    int mappedAdvice[] = {MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED};
+    int fileAdvice[] = {POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL, POSIX_FADV_RANDOM, POSIX_FADV_WILLNEED};
+    long long numMapped = (pageNum + numPages <= info->mappedPages) ? numPages : info->mappedPages - pageNum;
+    if (numMapped > 0 && madvise(info->mapping + (size_t)pageNum * info->pageSize, (size_t)numMapped * info->pageSize, mappedAdvice[advice]) != 0)
+        return RC_READ_NON_EXISTING_PAGE;
+    if (numMapped < 0)
+        numMapped = 0;
+    if (numMapped < numPages && posix_fadvise(info->fd, _pageOffset(info, pageNum + numMapped), 
+            (off_t)(numPages - numMapped) * info->pageSize, fileAdvice[advice]) != 0)
+        return RC_READ_NON_EXISTING_PAGE;
+    return RC_OK;
+}
+
+long long getBlockPos (SM_FileHandle *fHandle)
 {
     return fHandle->curPagePos;
 }
@@ -116,7 +371,7 @@ RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
     // get the previous `pageNum`
-    int pageNum = fHandle->curPagePos - 1;
+    long long pageNum = fHandle->curPagePos - 1;
     RC result = readBlock(pageNum, fHandle, memPage);
 
     // if the block was successfully read (and the pageNum was in range), update `pageNum`
@@ -133,7 +388,7 @@ RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
     // get the next `pageNum`
-    int pageNum = fHandle->curPagePos + 1;
+    long long pageNum = fHandle->curPagePos + 1;
     RC result = readBlock(pageNum, fHandle, memPage);
 
     // if the block was successfully read (and the pageNum was in range), update `pageNum`
@@ -149,21 +404,22 @@ RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 
 /* writing blocks to a page file */
 
-RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+RC writeBlock (long long pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
     // check the handle to see if pageNum is in range
     if (pageNum < 0 || pageNum >= fHandle->totalNumPages) 
         return RC_READ_NON_EXISTING_PAGE;
-    FILE *fp = (FILE *)fHandle->mgmtInfo;
 
-    // check to see if the position was set successfully
-    if (fseek(fp, pageNum * PAGE_SIZE, SEEK_SET) == 0)
-    {
-        size_t bytesWritten = fwrite(memPage, sizeof(char), PAGE_SIZE, fp);
-        if (bytesWritten != PAGE_SIZE) return RC_WRITE_FAILED;
-        else return RC_OK;
-    }    
-    else return RC_FILE_NOT_FOUND;
+    // the page is written at its offset, short writes are continued
+    return _transferBlocks((SM_FileInfo *)fHandle->mgmtInfo, pageNum, 1, &memPage, 1);
+}
+
+RC writeBlocks (long long pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages)
+{
+    // check the handle to see if all pages are in range
+    if (pageNum < 0 || numPages < 0 || pageNum + numPages > fHandle->totalNumPages) 
+        return RC_READ_NON_EXISTING_PAGE;
+    return _transferBlocks((SM_FileInfo *)fHandle->mgmtInfo, pageNum, numPages, memPages, 1);
 }
 
 RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
@@ -174,39 +430,385 @@ RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage)
 
 RC appendEmptyBlock (SM_FileHandle *fHandle)
 {
-    FILE *fp = (FILE *)fHandle->mgmtInfo;
+    return ensureCapacity(fHandle->totalNumPages + 1, fHandle);
+}
+
+RC ensureCapacity (long long numberOfPages, SM_FileHandle *fHandle)
+{
+    SM_FileInfo *info = (SM_FileInfo *)fHandle->mgmtInfo;
+    if (fHandle->totalNumPages >= numberOfPages)
+        return RC_OK;
 
-    // check to see if the position was set successfully
-    if (fseek(fp, 0, SEEK_END) == 0) 
+    // reserve disk space up to the end of the preallocation step holding the new last page 
+    // without changing the size, pages a jump skips stay sparse and file systems without 
+    // fallocate just keep the whole file sparse
+    if (info->preallocPages > 0 && info->allocatedPages < numberOfPages)
     {
-        // allocate a page of memory and fill the page with `\0` bytes
-        void *emptyPage = malloc(PAGE_SIZE); 
-        memset(emptyPage, '\0', PAGE_SIZE);
+        long long firstPage = (numberOfPages - 1) / info->preallocPages * info->preallocPages;
+        if (firstPage < info->allocatedPages)
+            firstPage = info->allocatedPages;
+        long long allocatedPages = firstPage - firstPage % info->preallocPages + info->preallocPages;
+        if (fallocate(info->fd, FALLOC_FL_KEEP_SIZE, _pageOffset(info, firstPage), 
+                (off_t)(allocatedPages - firstPage) * info->pageSize) == 0)
+            info->allocatedPages = allocatedPages;
+    }
 
-        // write the page to disk
-        size_t bytesWritten = fwrite(emptyPage, sizeof(char), PAGE_SIZE, fp);
-        free(emptyPage);
+    // extend the file in one step, the new pages read as `\0` bytes without being written
+    if (ftruncate(info->fd, _pageOffset(info, numberOfPages)) != 0)
+        return RC_WRITE_FAILED;
+    fHandle->totalNumPages = numberOfPages;
+    return RC_OK;
+}
 
-        // make sure the page was entirely written
-        if (bytesWritten != PAGE_SIZE) 
-            return RC_WRITE_FAILED;
-        else
+RC setPreallocation (SM_FileHandle *fHandle, int numPages)
+{
+    if (numPages < 0)
+        return RC_INVALID_STRATEGY_DATA;
+    ((SM_FileInfo *)fHandle->mgmtInfo)->preallocPages = numPages;
+    return RC_OK;
+}
+
+/* asynchronous reads and writes of page runs */
+
+// set up an io_uring with room for queueDepth requests, 1 if the kernel does not offer it
+int _setupRing(SM_AsyncInfo *info, int queueDepth)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    info->ringFd = syscall(__NR_io_uring_setup, queueDepth, &params);
+    if (info->ringFd < 0)
+        return 1;
+
+    // map the submission ring, the completion ring (both share one mapping on newer kernels) 
+    // and the submission entries
+    info->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    info->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap && info->cqRingSize > info->sqRingSize)
+        info->sqRingSize = info->cqRingSize;
+    info->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    info->sqRing = mmap(NULL, info->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, info->ringFd, IORING_OFF_SQ_RING);
+    info->cqRing = singleMap ? info->sqRing : mmap(NULL, info->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, info->ringFd, IORING_OFF_CQ_RING);
+    info->sqes = mmap(NULL, info->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, info->ringFd, IORING_OFF_SQES);
+    if (info->sqRing == MAP_FAILED || info->cqRing == MAP_FAILED || info->sqes == MAP_FAILED)
+    {
+        if (info->sqes != MAP_FAILED)
+            munmap(info->sqes, info->sqesSize);
+        if (!singleMap && info->cqRing != MAP_FAILED)
+            munmap(info->cqRing, info->cqRingSize);
+        if (info->sqRing != MAP_FAILED)
+            munmap(info->sqRing, info->sqRingSize);
+        close(info->ringFd);
+        return 1;
+    }
+    // a completion ring that shares the submission ring's mapping is not unmapped on its own
+    if (singleMap)
+        info->cqRingSize = 0;
+
+    info->sqTail = (unsigned *)((char *)info->sqRing + params.sq_off.tail);
+    info->sqMask = (unsigned *)((char *)info->sqRing + params.sq_off.ring_mask);
+    info->sqArray = (unsigned *)((char *)info->sqRing + params.sq_off.array);
+    info->cqHead = (unsigned *)((char *)info->cqRing + params.cq_off.head);
+    info->cqTail = (unsigned *)((char *)info->cqRing + params.cq_off.tail);
+    info->cqMask = (unsigned *)((char *)info->cqRing + params.cq_off.ring_mask);
+    info->cqes = (struct io_uring_cqe *)((char *)info->cqRing + params.cq_off.cqes);
+    info->numUnsubmitted = 0;
+    return 0;
+}
+
+// the I/O threads' main function, arg is the SM_AsyncInfo
+void *_runAsyncThread(void *arg)
+{
+    SM_AsyncInfo *info = (SM_AsyncInfo *)arg;
+    pthread_mutex_lock(&(info->latch));
+    while (true)
+    {
+        while (!info->stop && info->queueHead == NO_REQUEST)
+            pthread_cond_wait(&(info->submitted), &(info->latch));
+        if (info->queueHead == NO_REQUEST)
+            break;
+
+        // take the oldest request and transfer it without the latch
+        int r = info->queueHead;
+        SM_AsyncRequest *request = &(info->requests[r]);
+        info->queueHead = request->next;
+        if (info->queueHead == NO_REQUEST)
+            info->queueTail = NO_REQUEST;
+        pthread_mutex_unlock(&(info->latch));
+
+        request->result = _transferVectors(info->fd, request->iov, request->numVectors, request->offset, request->write);
+
+        pthread_mutex_lock(&(info->latch));
+        request->next = NO_REQUEST;
+        if (info->doneTail == NO_REQUEST)
+            info->doneHead = r;
+        else info->requests[info->doneTail].next = r;
+        info->doneTail = r;
+        info->numDone++;
+        pthread_cond_signal(&(info->finished));
+    }
+    pthread_mutex_unlock(&(info->latch));
+    return NULL;
+}
+
+RC initAsyncIO (SM_AsyncIO *aio, SM_FileHandle *fHandle, int queueDepth, SM_AsyncEngine engine)
+{
+    if (queueDepth < 1 || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    SM_AsyncInfo *info = malloc(sizeof(SM_AsyncInfo));
+    info->fHandle = fHandle;
+    info->fd = ((SM_FileInfo *)fHandle->mgmtInfo)->fd;
+    info->requests = malloc(queueDepth * sizeof(SM_AsyncRequest));
+    for (int r = 0; r < queueDepth; r++)
+        info->requests[r].next = (r + 1 < queueDepth) ? r + 1 : NO_REQUEST;
+    info->freeRequests = 0;
+
+    // without an io_uring the requests are handed to threads
+    if (engine == SM_ASYNC_URING && _setupRing(info, queueDepth) != 0)
+        engine = SM_ASYNC_THREADS;
+    info->numThreads = 0;
+    info->doneHead = info->doneTail = NO_REQUEST;
+    info->numDone = 0;
+    if (engine == SM_ASYNC_THREADS)
+    {
+        info->queueHead = info->queueTail = NO_REQUEST;
+        info->stop = false;
+        pthread_mutex_init(&(info->latch), NULL);
+        pthread_cond_init(&(info->submitted), NULL);
+        pthread_cond_init(&(info->finished), NULL);
+        info->numThreads = (queueDepth < MAX_ASYNC_THREADS) ? queueDepth : MAX_ASYNC_THREADS;
+        info->threads = malloc(info->numThreads * sizeof(pthread_t));
+        for (int t = 0; t < info->numThreads; t++)
+            pthread_create(&(info->threads[t]), NULL, _runAsyncThread, info);
+    }
+
+    aio->engine = engine;
+    aio->queueDepth = queueDepth;
+    aio->inFlight = 0;
+    aio->mgmtInfo = (void *)info;
+    return RC_OK;
+}
+
+// queue a transfer of numPages consecutive pages starting at pageNum, the io_uring learns of
+// it with the next reapBlocks
+RC _submitBlocks(SM_AsyncIO *aio, long long pageNum, int numPages, SM_PageHandle *memPages, void *userData, int write)
+{
+    SM_AsyncInfo *info = (SM_AsyncInfo *)aio->mgmtInfo;
+    SM_FileInfo *fileInfo = (SM_FileInfo *)info->fHandle->mgmtInfo;
+
+    // check the handle to see if all pages are in range, and that there is a free slot
+    if (pageNum < 0 || numPages < 1 || numPages > MAX_IO_VECTORS || pageNum + numPages > info->fHandle->totalNumPages) 
+        return RC_READ_NON_EXISTING_PAGE;
+    if (aio->inFlight == aio->queueDepth)
+        return RC_WRITE_FAILED;
+
+    int r = info->freeRequests;
+    SM_AsyncRequest *request = &(info->requests[r]);
+    info->freeRequests = request->next;
+    request->userData = userData;
+    request->iov = malloc(numPages * sizeof(struct iovec));
+    for (int i = 0; i < numPages; i++)
+    {
+        request->iov[i].iov_base = memPages[i];
+        request->iov[i].iov_len = fileInfo->pageSize;
+    }
+    request->numVectors = numPages;
+    request->offset = _pageOffset(fileInfo, pageNum);
+    request->write = write;
+    aio->inFlight++;
+
+    if (aio->engine == SM_ASYNC_URING)
+    {
+        // there is a submission entry for every request slot, so the ring is never full
+        unsigned tail = *(info->sqTail);
+        unsigned index = tail & *(info->sqMask);
+        struct io_uring_sqe *sqe = &(info->sqes[index]);
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe->fd = info->fd;
+        sqe->off = request->offset;
+        sqe->addr = (unsigned long)request->iov;
+        sqe->len = numPages;
+        sqe->user_data = r;
+        info->sqArray[index] = index;
+        __atomic_store_n(info->sqTail, tail + 1, __ATOMIC_RELEASE);
+        info->numUnsubmitted++;
+    }
+    else
+    {
+        pthread_mutex_lock(&(info->latch));
+        request->next = NO_REQUEST;
+        if (info->queueTail == NO_REQUEST)
+            info->queueHead = r;
+        else info->requests[info->queueTail].next = r;
+        info->queueTail = r;
+        pthread_cond_signal(&(info->submitted));
+        pthread_mutex_unlock(&(info->latch));
+    }
+    return RC_OK;
+}
+
+RC submitReadBlocks (SM_AsyncIO *aio, long long pageNum, int numPages, SM_PageHandle *memPages, void *userData)
+{
+    return _submitBlocks(aio, pageNum, numPages, memPages, userData, 0);
+}
+
+RC submitWriteBlocks (SM_AsyncIO *aio, long long pageNum, int numPages, SM_PageHandle *memPages, void *userData)
+{
+    return _submitBlocks(aio, pageNum, numPages, memPages, userData, 1);
+}
+
+// hand a finished request to the caller and free its slot
+void _completeRequest(SM_AsyncIO *aio, int r, SM_Completion *completion)
+{
+    SM_AsyncInfo *info = (SM_AsyncInfo *)aio->mgmtInfo;
+    SM_AsyncRequest *request = &(info->requests[r]);
+    completion->userData = request->userData;
+    completion->result = request->result;
+    free(request->iov);
+    request->next = info->freeRequests;
+    info->freeRequests = r;
+    aio->inFlight--;
+}
+
+// take the submissions the kernel was not told about back out of the io_uring, transfer them
+// synchronously and queue them as finished
+void _withdrawRequests(SM_AsyncInfo *info)
+{
+    unsigned tail = *(info->sqTail) - info->numUnsubmitted;
+    for (unsigned t = tail; t != *(info->sqTail); t++)
+    {
+        int r = info->sqes[info->sqArray[t & *(info->sqMask)]].user_data;
+        SM_AsyncRequest *request = &(info->requests[r]);
+        request->result = _transferVectors(info->fd, request->iov, request->numVectors, request->offset, request->write);
+        request->next = NO_REQUEST;
+        if (info->doneTail == NO_REQUEST)
+            info->doneHead = r;
+        else info->requests[info->doneTail].next = r;
+        info->doneTail = r;
+        info->numDone++;
+    }
+    __atomic_store_n(info->sqTail, tail, __ATOMIC_RELEASE);
+    info->numUnsubmitted = 0;
+}
+
+int reapBlocks (SM_AsyncIO *aio, SM_Completion *completions, int minCompletions, int maxCompletions)
+{
+    SM_AsyncInfo *info = (SM_AsyncInfo *)aio->mgmtInfo;
+    int numReaped = 0;
+    if (minCompletions > aio->inFlight)
+        minCompletions = aio->inFlight;
+    if (minCompletions > maxCompletions)
+        minCompletions = maxCompletions;
+
+    if (aio->engine == SM_ASYNC_THREADS)
+    {
+        pthread_mutex_lock(&(info->latch));
+        while (info->numDone < minCompletions)
+            pthread_cond_wait(&(info->finished), &(info->latch));
+        int head = info->doneHead;
+        while (head != NO_REQUEST && numReaped < maxCompletions)
         {
-            fHandle->totalNumPages++;
-            return RC_OK;
+            int r = head;
+            head = info->requests[r].next;
+            _completeRequest(aio, r, &(completions[numReaped++]));
+        }
+        info->doneHead = head;
+        if (head == NO_REQUEST)
+            info->doneTail = NO_REQUEST;
+        info->numDone -= numReaped;
+        pthread_mutex_unlock(&(info->latch));
+        return numReaped;
+    }
+
+    while (true)
+    {
+        // take the requests that were taken back from the ring
+        while (info->doneHead != NO_REQUEST && numReaped < maxCompletions)
+        {
+            int r = info->doneHead;
+            info->doneHead = info->requests[r].next;
+            info->numDone--;
+            _completeRequest(aio, r, &(completions[numReaped++]));
+        }
+        if (info->doneHead == NO_REQUEST)
+            info->doneTail = NO_REQUEST;
+
+        // take what the kernel has completed
+        unsigned head = *(info->cqHead);
+        unsigned tail = __atomic_load_n(info->cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail && numReaped < maxCompletions)
+        {
+            struct io_uring_cqe *cqe = &(info->cqes[head & *(info->cqMask)]);
+            SM_AsyncRequest *request = &(info->requests[cqe->user_data]);
+            if (cqe->res < 0)
+                request->result = request->write ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+            else
+            {
+                // a short transfer is finished synchronously
+                struct iovec *next = request->iov;
+                int remaining = request->numVectors;
+                _skipVectors(&next, &remaining, cqe->res);
+                request->result = _transferVectors(info->fd, next, remaining, request->offset + cqe->res, request->write);
+            }
+            _completeRequest(aio, cqe->user_data, &(completions[numReaped++]));
+            head++;
+        }
+        __atomic_store_n(info->cqHead, head, __ATOMIC_RELEASE);
+        if (numReaped >= minCompletions && info->numUnsubmitted == 0)
+            return numReaped;
+
+        // submit the queued requests and wait for the missing completions in one system call
+        unsigned wait = (numReaped < minCompletions) ? minCompletions - numReaped : 0;
+        int submitted = syscall(__NR_io_uring_enter, info->ringFd, info->numUnsubmitted, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (submitted > 0)
+            info->numUnsubmitted -= submitted;
+        else if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            // the kernel did not take the queued requests (they were counted in flight when 
+            // they were queued), they are taken back out of the ring and transferred 
+            // synchronously, what is in the kernel already can only be polled for
+            if (info->numUnsubmitted == 0)
+                return numReaped;
+            _withdrawRequests(info);
         }
     }
-    else return RC_FILE_NOT_FOUND;
 }
 
-RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle)
+RC shutdownAsyncIO (SM_AsyncIO *aio)
 {
-    // while `totalNumPages` is less than `numberOfPages` keep calling `appendEmptyBlock`
-    while (fHandle->totalNumPages < numberOfPages)
+    SM_AsyncInfo *info = (SM_AsyncInfo *)aio->mgmtInfo;
+    if (info == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    // requests still in flight are finished first
+    SM_Completion completion;
+    while (aio->inFlight > 0 && reapBlocks(aio, &completion, 1, 1) == 1);
+
+    if (aio->engine == SM_ASYNC_URING)
     {
-        RC result = appendEmptyBlock(fHandle);
-        if (result != RC_OK) 
-            return result;
+        munmap(info->sqes, info->sqesSize);
+        if (info->cqRingSize > 0)
+            munmap(info->cqRing, info->cqRingSize);
+        munmap(info->sqRing, info->sqRingSize);
+        close(info->ringFd);
     }
+    else
+    {
+        pthread_mutex_lock(&(info->latch));
+        info->stop = true;
+        pthread_cond_broadcast(&(info->submitted));
+        pthread_mutex_unlock(&(info->latch));
+        for (int t = 0; t < info->numThreads; t++)
+            pthread_join(info->threads[t], NULL);
+        free(info->threads);
+        pthread_mutex_destroy(&(info->latch));
+        pthread_cond_destroy(&(info->submitted));
+        pthread_cond_destroy(&(info->finished));
+    }
+    free(info->requests);
+    free(info);
+    aio->mgmtInfo = NULL;
     return RC_OK;
-}
\ No newline at end of file
+}
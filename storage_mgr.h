@@ -8,36 +8,91 @@
  ************************************************************/
 typedef struct SM_FileHandle {
 	char *fileName;
-	int totalNumPages;
-	int curPagePos;
+	long long totalNumPages;
+	long long curPagePos;
+	int pageSize; // the size of the file's pages, recorded in its header
 	void *mgmtInfo;
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+// page sizes a page file may have (powers of two), PAGE_SIZE is the default
+#define MIN_PAGE_SIZE PAGE_SIZE
+#define MAX_PAGE_SIZE (1024 * 1024)
+
+// flags of openPageFileWithFlags
+#define SM_OPEN_DIRECT 1 // bypass the kernel page cache, all page buffers must be PAGE_SIZE aligned
+#define SM_OPEN_MAPPED 2 // also map the pages the file has when it is opened read-only
+
+// access pattern hints for the pages of a file
+typedef enum SM_Advice {
+	SM_ADVICE_NORMAL = 0,
+	SM_ADVICE_SEQUENTIAL = 1, // read far ahead
+	SM_ADVICE_RANDOM = 2, // do not read ahead
+	SM_ADVICE_WILLNEED = 3 // start reading the pages now
+} SM_Advice;
+
+// the most pages a single vectored transfer moves (the portable minimum of IOV_MAX), longer 
+// runs are split
+#define MAX_IO_VECTORS 1024
+
+// engines behind the asynchronous interface
+typedef enum SM_AsyncEngine {
+	SM_ASYNC_URING = 0, // an io_uring, falls back to threads where the kernel has none
+	SM_ASYNC_THREADS = 1 // a pool of I/O threads doing positional reads and writes
+} SM_AsyncEngine;
+
+// an asynchronous I/O queue on an open page file, it is used by one thread at a time
+typedef struct SM_AsyncIO {
+	SM_AsyncEngine engine; // the engine in use
+	int queueDepth; // the most requests in flight at once
+	int inFlight; // requests submitted and not reaped yet
+	void *mgmtInfo;
+} SM_AsyncIO;
+
+// a finished asynchronous request
+typedef struct SM_Completion {
+	void *userData;
+	RC result;
+} SM_Completion;
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
 /* manipulating page files */
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
+extern RC createPageFileWithPageSize (char *fileName, int pageSize);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileWithFlags (char *fileName, SM_FileHandle *fHandle, int flags);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
 
 /* reading blocks from disc */
-extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
-extern int getBlockPos (SM_FileHandle *fHandle);
+extern RC readBlock (long long pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern long long getBlockPos (SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC readBlocks (long long pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
+extern SM_PageHandle getMappedBlock (long long pageNum, SM_FileHandle *fHandle);
+extern RC adviseBlocks (long long pageNum, long long numPages, SM_FileHandle *fHandle, SM_Advice advice);
 
 /* writing blocks to a page file */
-extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlock (long long pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocks (long long pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
-extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC ensureCapacity (long long numberOfPages, SM_FileHandle *fHandle);
+extern RC setPreallocation (SM_FileHandle *fHandle, int numPages);
+
+/* asynchronous reads and writes of page runs */
+extern RC initAsyncIO (SM_AsyncIO *aio, SM_FileHandle *fHandle, int queueDepth, SM_AsyncEngine engine);
+extern RC submitReadBlocks (SM_AsyncIO *aio, long long pageNum, int numPages, SM_PageHandle *memPages, void *userData);
+extern RC submitWriteBlocks (SM_AsyncIO *aio, long long pageNum, int numPages, SM_PageHandle *memPages, void *userData);
+extern int reapBlocks (SM_AsyncIO *aio, SM_Completion *completions, int minCompletions, int maxCompletions);
+extern RC shutdownAsyncIO (SM_AsyncIO *aio);
 
 #endif
@@ -85,7 +85,7 @@ createDummyPages(BM_BufferPool *bm, int num)
   for (i = 0; i < num; i++)
     {
       CHECK(pinPage(bm, h, i));
-      sprintf(h->data, "%s-%i", "Page", h->pageNum);
+      sprintf(h->data, "%s-%lld", "Page", h->pageNum);
       CHECK(markDirty(bm, h));
       CHECK(unpinPage(bm,h));
     }
@@ -108,7 +108,7 @@ checkDummyPages(BM_BufferPool *bm, int num)
     {
       CHECK(pinPage(bm, h, i));
 
-      sprintf(expected, "%s-%i", "Page", h->pageNum);
+      sprintf(expected, "%s-%lld", "Page", h->pageNum);
       ASSERT_EQUALS_STRING(expected, h->data, "reading back dummy page content");
 
       CHECK(unpinPage(bm,h));
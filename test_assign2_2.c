@@ -7,6 +7,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <signal.h>
 
 // var to store the current test's name
 char *testName;
@@ -28,11 +33,71 @@ printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, re
 free(real);                                \
 } while(0)
 
+// pool and error count shared by the threads of testConcurrent
+#define NUM_THREADS 4
+static BM_BufferPool *concurrentPool;
+static int concurrentErrors;
+static int concurrentStop;
+
 // test and helper methods
 static void createDummyPages(BM_BufferPool *bm, int num);
 
+static void *concurrentReader(void *arg);
+
+static void *concurrentEvictor(void *arg);
+
+static void *delayedUnpin(void *arg);
+
+static void *fileFlusher(void *arg);
+
 static void testLRU_K (void);
 
+static void testLRU_2 (void);
+
+static void testCLOCK (void);
+
+static void testLFU (void);
+
+static void testARC (void);
+
+static void testAdmission (void);
+
+static void testConcurrent (void);
+
+static void testConcurrentEviction (void);
+
+static void testPartitions (void);
+
+static void testBackgroundWriter (void);
+
+static void testPrefetch (void);
+
+static void testPinPages (void);
+
+static void testReadError (void);
+
+static void testWriteError (void);
+
+static void testFlush (void);
+
+static void testHugePages (void);
+
+static void testAsyncIO (void);
+
+static void testDirectIO (void);
+
+static void testMappedPool (void);
+
+static void testPreallocation (void);
+
+static void testLargeFile (void);
+
+static void testPageSize (void);
+
+static void testMultiFile (void);
+
+static void testResize (void);
+
 static void testError (void);
 
 // main method
@@ -43,6 +108,29 @@ main (void)
     testName = "";
     
     testLRU_K();
+    testLRU_2();
+    testCLOCK();
+    testLFU();
+    testARC();
+    testAdmission();
+    testConcurrent();
+    testConcurrentEviction();
+    testPartitions();
+    testBackgroundWriter();
+    testPrefetch();
+    testPinPages();
+    testReadError();
+    testWriteError();
+    testFlush();
+    testHugePages();
+    testAsyncIO();
+    testDirectIO();
+    testMappedPool();
+    testPreallocation();
+    testLargeFile();
+    testPageSize();
+    testMultiFile();
+    testResize();
     testError();
     return 0;
 }
@@ -59,7 +147,7 @@ createDummyPages(BM_BufferPool *bm, int num)
     for (i = 0; i < num; i++)
     {
         CHECK(pinPage(bm, h, i));
-        sprintf(h->data, "%s-%i", "Page", h->pageNum);
+        sprintf(h->data, "%s-%lld", "Page", h->pageNum);
         CHECK(markDirty(bm, h));
         CHECK(unpinPage(bm,h));
     }
@@ -105,8 +193,7 @@ testLRU_K (void)
     
     CHECK(createPageFile("testbuffer.bin"));
     createDummyPages(bm, 100);
-    // int k = 1; CHECK(initBufferPool(bm, "testbuffer.bin", 5, RS_LRU_K, &k));
-    CHECK(initBufferPool(bm, "testbuffer.bin", 5, RS_LRU_K, NULL));
+    int k = 1; CHECK(initBufferPool(bm, "testbuffer.bin", 5, RS_LRU_K, &k));
     
     // reading first five pages linearly with direct unpin and no modifications
     for(i = 0; i < 5; i++)
@@ -144,6 +231,1665 @@ testLRU_K (void)
     TEST_DONE();
 }
 
+// test that LRU-2 (the default K) survives a scan and keeps the history of evicted pages
+void
+testLRU_2 (void)
+{
+    // expected results
+    const char *poolContents[] = {
+        // reference pages 0 and 1 twice and page 2 once
+        "[0 0],[-1 0],[-1 0]",
+        "[0 0],[1 0],[-1 0]",
+        "[0 0],[1 0],[-1 0]",
+        "[0 0],[1 0],[-1 0]",
+        "[0 0],[1 0],[2 0]",
+        // a scan only replaces pages with a single reference
+        "[0 0],[1 0],[3 0]",
+        "[0 0],[1 0],[4 0]",
+        "[0 0],[1 0],[5 0]",
+        // page 3 comes back with its retained history and now has two references
+        "[0 0],[1 0],[3 0]",
+        // so page 0 has the oldest second to last reference
+        "[6 0],[1 0],[3 0]"
+    };
+    const int requests[] = {0,1,0,1,2,3,4,5,3,6};
+    const int numRequests = 10;
+    
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing LRU-2 page replacement";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, NULL));
+    
+    for(i = 0; i < numRequests; i++)
+    {
+        pinPage(bm, h, requests[i]);
+        unpinPage(bm, h);
+        ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content using pages");
+    }
+    
+    // check number of write IOs
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+    ASSERT_EQUALS_INT(8, getNumReadIO(bm), "check number of read I/Os");
+    
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test the CLOCK page replacement strategy
+void
+testCLOCK (void)
+{
+    // expected results
+    const char *poolContents[] = {
+        // read first five pages and directly unpin them
+        "[0 0],[-1 0],[-1 0],[-1 0],[-1 0]" ,
+        "[0 0],[1 0],[-1 0],[-1 0],[-1 0]",
+        "[0 0],[1 0],[2 0],[-1 0],[-1 0]",
+        "[0 0],[1 0],[2 0],[3 0],[-1 0]",
+        "[0 0],[1 0],[2 0],[3 0],[4 0]",
+        // a full sweep clears every reference bit and evicts the first frame
+        "[5 0],[1 0],[2 0],[3 0],[4 0]",
+        // reference pages 2 and 4 to give them a second chance
+        "[5 0],[1 0],[2 0],[3 0],[4 0]",
+        "[5 0],[1 0],[2 0],[3 0],[4 0]",
+        // check that referenced pages are skipped once
+        "[5 0],[6 0],[2 0],[3 0],[4 0]",
+        "[5 0],[6 0],[2 0],[7 0],[4 0]",
+        "[5 0],[6 0],[8 0],[7 0],[4 0]",
+        // check that the hand skips pinned frames
+        "[5 0],[6 0],[8 0],[7 0],[4 1]",
+        "[9 0],[6 0],[8 0],[7 0],[4 1]",
+        "[9 0],[6 0],[8 0],[7 0],[4 0]"
+    };
+    const int referenceRequests[] = {2,4};
+    const int numReferences = 2;
+    
+    int i;
+    int snapshot = 0;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+    testName = "Testing CLOCK page replacement";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 5, RS_CLOCK, NULL));
+    
+    // reading first six pages linearly with direct unpin and no modifications
+    for(i = 0; i < 6; i++)
+    {
+        pinPage(bm, h, i);
+        unpinPage(bm, h);
+        ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content reading in pages");
+    }
+    
+    // set reference bits without changing pool content
+    for(i = 0; i < numReferences; i++)
+    {
+        pinPage(bm, h, referenceRequests[i]);
+        unpinPage(bm, h);
+        ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content using pages");
+    }
+    
+    // replace pages and check that it happens in CLOCK order
+    for(i = 6; i < 9; i++)
+    {
+        pinPage(bm, h, i);
+        unpinPage(bm, h);
+        ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content using pages");
+    }
+    
+    // keep page 4 pinned while the hand passes over it
+    pinPage(bm, pinned, 4);
+    ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "pool content after pin page");
+    pinPage(bm, h, 9);
+    unpinPage(bm, h);
+    ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "check pool content using pages");
+    unpinPage(bm, pinned);
+    ASSERT_EQUALS_POOL(poolContents[snapshot++], bm, "unpin last page");
+    
+    // check number of write IOs
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+    ASSERT_EQUALS_INT(10, getNumReadIO(bm), "check number of read I/Os");
+    
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    free(pinned);
+    TEST_DONE();
+}
+
+// test the LFU page replacement strategy and its aging
+void
+testLFU (void)
+{
+    // expected results
+    const char *poolContents[] = {
+        // reference page 0 three times, page 1 twice and page 2 once
+        "[0 0],[-1 0],[-1 0]",
+        "[0 0],[-1 0],[-1 0]",
+        "[0 0],[-1 0],[-1 0]",
+        "[0 0],[1 0],[-1 0]",
+        "[0 0],[1 0],[-1 0]",
+        "[0 0],[1 0],[2 0]",
+        // the least frequently used page is replaced
+        "[0 0],[1 0],[3 0]",
+        "[0 0],[1 0],[4 0]",
+        // until page 4 is referenced more often than page 1
+        "[0 0],[1 0],[4 0]",
+        "[0 0],[1 0],[4 0]",
+        "[0 0],[5 0],[4 0]"
+    };
+    const int requests[] = {0,0,0,1,1,2,3,4,4,4,5};
+    const int numRequests = 11;
+    
+    // with an aging period of 4 references, page 0 loses its lead over page 1
+    const char *agingContents[] = {
+        "[0 0],[-1 0]",
+        "[0 0],[-1 0]",
+        "[0 0],[-1 0]",
+        "[0 0],[1 0]",
+        "[0 0],[1 0]",
+        "[0 0],[1 0]",
+        "[2 0],[1 0]"
+    };
+    const int agingRequests[] = {0,0,0,1,1,1,2};
+    const int numAgingRequests = 7;
+    int agingPeriod = 4;
+    
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing LFU page replacement";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LFU, NULL));
+    
+    for(i = 0; i < numRequests; i++)
+    {
+        pinPage(bm, h, requests[i]);
+        unpinPage(bm, h);
+        ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content using pages");
+    }
+    
+    // check number of write IOs
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+    ASSERT_EQUALS_INT(6, getNumReadIO(bm), "check number of read I/Os");
+    CHECK(shutdownBufferPool(bm));
+    
+    CHECK(initBufferPool(bm, "testbuffer.bin", 2, RS_LFU, &agingPeriod));
+    for(i = 0; i < numAgingRequests; i++)
+    {
+        pinPage(bm, h, agingRequests[i]);
+        unpinPage(bm, h);
+        ASSERT_EQUALS_POOL(agingContents[i], bm, "check pool content with aging");
+    }
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test the ARC page replacement strategy
+void
+testARC (void)
+{
+    // expected results
+    const char *poolContents[] = {
+        // pages 0 and 1 are referenced twice and move to T2, page 2 stays in T1
+        "[0 0],[-1 0],[-1 0]",
+        "[0 0],[1 0],[-1 0]",
+        "[0 0],[1 0],[-1 0]",
+        "[0 0],[1 0],[-1 0]",
+        "[0 0],[1 0],[2 0]",
+        // a scan only replaces pages in T1, they are remembered in B1
+        "[0 0],[1 0],[3 0]",
+        "[0 0],[1 0],[4 0]",
+        "[0 0],[1 0],[5 0]",
+        // a hit in B1 grows the target for T1, so the LRU page of T2 makes room
+        "[3 0],[1 0],[5 0]",
+        // a hit in B2 shrinks it again, so the LRU page of T1 makes room
+        "[3 0],[1 0],[0 0]"
+    };
+    const int requests[] = {0,1,0,1,2,3,4,5,3,0};
+    const int numRequests = 10;
+    
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing ARC page replacement";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_ARC, NULL));
+    
+    for(i = 0; i < numRequests; i++)
+    {
+        pinPage(bm, h, requests[i]);
+        unpinPage(bm, h);
+        ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content using pages");
+    }
+    
+    // check number of write IOs
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+    ASSERT_EQUALS_INT(8, getNumReadIO(bm), "check number of read I/Os");
+    
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test the TinyLFU admission filter in front of FIFO
+void
+testAdmission (void)
+{
+    // expected results
+    const char *poolContents[] = {
+        // reference pages 0, 1 and 2 three times each
+        "[0 0],[-1 0],[-1 0]",
+        "[0 0],[1 0],[-1 0]",
+        "[0 0],[1 0],[2 0]",
+        // page 7 is requested less often than the victim, so it is served from the scratch frame
+        "[0 0],[1 0],[2 0]",
+        "[0 0],[1 0],[2 0]",
+        // so is page 6, which replaces page 7 in the scratch frame
+        "[0 0],[1 0],[2 0]",
+        // by now page 7 was requested more often than the victim and is admitted
+        "[7 0],[1 0],[2 0]"
+    };
+    const int requests[] = {0,1,2,7,7,6,7};
+    const int repeats[] = {3,3,3,1,3,1,1};
+    const int numRequests = 7;
+    BM_PoolOptions options = {0};
+    
+    int i, j;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing TinyLFU admission";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    options.admissionSketchBytes = 1024;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, &options));
+    
+    for(i = 0; i < numRequests; i++)
+    {
+        for (j = 0; j < repeats[i]; j++)
+        {
+            CHECK(pinPage(bm, h, requests[i]));
+            CHECK(unpinPage(bm, h));
+        }
+        ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content using pages");
+    }
+    
+    // pages served from the scratch frame are still read from disk
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+    ASSERT_EQUALS_INT(6, getNumReadIO(bm), "check number of read I/Os");
+    
+    CHECK(shutdownBufferPool(bm));
+    
+    // rejected pages leave the CLOCK hand and reference bits alone: pages 0, 1 and 2 stay 
+    // referenced while pages 7 and 6 take turns in the scratch frame, so page 7 is admitted 
+    // into the frame the second sweep stops at
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_CLOCK, NULL, &options));
+    for(i = 0; i < 3; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            CHECK(pinPage(bm, h, i));
+            CHECK(unpinPage(bm, h));
+        }
+    }
+    for (j = 0; j < 4; j++)
+    {
+        CHECK(pinPage(bm, h, 7));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(pinPage(bm, h, 6));
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", bm, "check pool content before page 7 is admitted");
+    CHECK(pinPage(bm, h, 7));
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_POOL("[7 0],[1 0],[2 0]", bm, "check page 7 replaced the page at the hand");
+    
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// pin pages 0 to 9 a hundred times, starting at a different page in each thread
+void *
+concurrentReader (void *arg)
+{
+    long thread = (long)arg;
+    int i, j;
+    char expected[16];
+    BM_PageHandle h;
+    
+    for (i = 0; i < 100; i++)
+    {
+        for (j = 0; j < 10; j++)
+        {
+            int pageNum = (j + thread * 3) % 10;
+            if (pinPage(concurrentPool, &h, pageNum) != RC_OK)
+            {
+                __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+                continue;
+            }
+            sprintf(expected, "%s-%i", "Page", pageNum);
+            if (h.pageNum != pageNum || strcmp(expected, h.data) != 0)
+                __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+            if (unpinPage(concurrentPool, &h) != RC_OK)
+                __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+// test a concurrent pool, pins of the same page from several threads read it only once
+void
+testConcurrent (void)
+{
+    const ReplacementStrategy strategies[] = {RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC};
+    const int numStrategies = 6;
+    BM_PoolOptions options = {0};
+    pthread_t threads[NUM_THREADS];
+    
+    long i;
+    int s;
+    BM_BufferPool *bm = MAKE_POOL();
+    testName = "Testing concurrent pool";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+    options.concurrent = true;
+    concurrentPool = bm;
+    
+    for (s = 0; s < numStrategies; s++)
+    {
+        CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 10, strategies[s], NULL, &options));
+        concurrentErrors = 0;
+        for (i = 0; i < NUM_THREADS; i++)
+            pthread_create(&threads[i], NULL, concurrentReader, (void *)i);
+        for (i = 0; i < NUM_THREADS; i++)
+            pthread_join(threads[i], NULL);
+        
+        ASSERT_EQUALS_INT(0, concurrentErrors, "check pages pinned by all threads");
+        ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+        ASSERT_EQUALS_INT(10, getNumReadIO(bm), "check number of read I/Os");
+        CHECK(shutdownBufferPool(bm));
+    }
+    
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    TEST_DONE();
+}
+
+// pin pages 0 to 39 in a different order in each thread, dirtying every other one, so the
+// pages keep getting evicted (and written back) while the other threads pin them
+void *
+concurrentEvictor (void *arg)
+{
+    long thread = (long)arg;
+    int i;
+    char expected[16];
+    BM_PageHandle h;
+    
+    for (i = 0; i < 2000; i++)
+    {
+        int pageNum = (i * (2 * thread + 1) + thread * 7) % 40;
+        if (pinPage(concurrentPool, &h, pageNum) != RC_OK)
+        {
+            __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        sprintf(expected, "%s-%i", "Page", pageNum);
+        if (h.pageNum != pageNum || strcmp(expected, h.data) != 0)
+            __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+        if (i % 2 == 0 && markDirty(concurrentPool, &h) != RC_OK)
+            __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+        if (unpinPage(concurrentPool, &h) != RC_OK)
+            __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+// unpin the page handle arg of concurrentPool after 20ms
+void *
+delayedUnpin (void *arg)
+{
+    usleep(20000);
+    if (unpinPage(concurrentPool, (BM_PageHandle *)arg) != RC_OK)
+        __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+// dirty pages of the pool's own file and flush the pool until concurrentStop is set, the 
+// misses evict the pages of the other files
+void *
+fileFlusher (void *arg)
+{
+    int i;
+    BM_PageHandle h;
+    
+    for (i = 0; !__atomic_load_n(&concurrentStop, __ATOMIC_RELAXED); i++)
+    {
+        if (pinPage(concurrentPool, &h, i % 10) != RC_OK)
+        {
+            __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (markDirty(concurrentPool, &h) != RC_OK || unpinPage(concurrentPool, &h) != RC_OK)
+            __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+        if (i % 10 == 0 && forceFlushPool(concurrentPool) != RC_OK)
+            __atomic_add_fetch(&concurrentErrors, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+// test a concurrent pool whose working set is larger than the pool, the pages keep their
+// content while frames are evicted and reused under the pins of the other threads
+void
+testConcurrentEviction (void)
+{
+    const ReplacementStrategy strategies[] = {RS_FIFO, RS_LRU, RS_CLOCK};
+    const int numStrategies = 3;
+    BM_PoolOptions options = {0};
+    pthread_t threads[NUM_THREADS];
+    char expected[16];
+    
+    long i;
+    int s;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing concurrent pool with evictions";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 40);
+    options.concurrent = true;
+    concurrentPool = bm;
+    
+    for (s = 0; s < numStrategies; s++)
+    {
+        CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, strategies[s], NULL, &options));
+        concurrentErrors = 0;
+        for (i = 0; i < NUM_THREADS; i++)
+            pthread_create(&threads[i], NULL, concurrentEvictor, (void *)i);
+        for (i = 0; i < NUM_THREADS; i++)
+            pthread_join(threads[i], NULL);
+        
+        ASSERT_EQUALS_INT(0, concurrentErrors, "check pages pinned by all threads");
+        ASSERT_TRUE(getNumReadIO(bm) > 40, "pages were evicted and read again");
+        ASSERT_TRUE(getNumWriteIO(bm) > 0, "dirty pages were written back on eviction");
+        CHECK(shutdownBufferPool(bm));
+        
+        // the written back pages read back with their content
+        CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_FIFO, NULL));
+        for (i = 0; i < 40; i++)
+        {
+            CHECK(pinPage(bm, h, i));
+            sprintf(expected, "%s-%li", "Page", i);
+            ASSERT_EQUALS_STRING(expected, h->data, "reading back page content after evictions");
+            CHECK(unpinPage(bm, h));
+        }
+        CHECK(shutdownBufferPool(bm));
+    }
+    
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test a pool split into partitions, which still behaves like one pool of all frames
+void
+testPartitions (void)
+{
+    BM_PoolOptions options = {0};
+    char expected[16];
+    
+    int i;
+    int numResident = 0;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing partitioned pool";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    
+    // every partition needs a frame
+    options.numPartitions = 10;
+    ASSERT_EQUALS_INT(RC_INVALID_STRATEGY_DATA, initBufferPoolWithOptions(bm, "testbuffer.bin", 9, RS_FIFO, NULL, &options), "more partitions than frames");
+    
+    options.numPartitions = 3;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 9, RS_FIFO, NULL, &options));
+    for (i = 0; i < 100; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(expected, "%s-%i", "Page", i);
+        ASSERT_EQUALS_STRING(expected, h->data, "reading back dummy page content");
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    
+    // every miss after the partitions filled up wrote back a dirty page
+    ASSERT_EQUALS_INT(100, getNumReadIO(bm), "check number of read I/Os");
+    ASSERT_EQUALS_INT(91, getNumWriteIO(bm), "check number of write I/Os");
+    
+    // the statistics cover the frames of all partitions
+    PageNumber *frameContents = getFrameContents(bm);
+    for (i = 0; i < 9; i++)
+    {
+        if (frameContents[i] != NO_PAGE)
+            numResident++;
+    }
+    free(frameContents);
+    ASSERT_EQUALS_INT(9, numResident, "all frames hold a page");
+    
+    CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(100, getNumWriteIO(bm), "check number of write I/Os after flush");
+    
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test that the background writer cleans the pool, so later misses find clean victims
+void
+testBackgroundWriter (void)
+{
+    BM_PoolOptions options = {0};
+    BM_BufferPool invalidPool;
+    
+    int i;
+    int waited = 0;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing background writer";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 20);
+    
+    // clean every dirty page, one round of the writer covers the whole pool
+    options.backgroundWriter = true;
+    options.writerIntervalMs = 1;
+    options.writerPagesPerRound = 10;
+    options.dirtyHighWatermark = 10;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 10, RS_LRU, NULL, &options));
+    for (i = 0; i < 10; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    
+    // give the writer up to 5 seconds
+    while (getNumWriteIO(bm) < 10 && waited < 5000)
+    {
+        usleep(1000);
+        waited++;
+    }
+    ASSERT_EQUALS_INT(10, getNumWriteIO(bm), "the writer wrote all dirty pages");
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0],[4 0],[5 0],[6 0],[7 0],[8 0],[9 0]", bm, "all pages are clean");
+    
+    // the misses only read
+    for (i = 10; i < 20; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(20, getNumReadIO(bm), "check number of read I/Os");
+    ASSERT_EQUALS_INT(10, getNumWriteIO(bm), "no write on the miss path");
+    
+    // the watermarks must be ordered
+    options.dirtyLowWatermark = 50;
+    ASSERT_EQUALS_INT(RC_INVALID_STRATEGY_DATA, initBufferPoolWithOptions(&invalidPool, "testbuffer.bin", 10, RS_LRU, NULL, &options), "low watermark above high watermark");
+    
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test that prefetched pages are read once, by the prefetch threads or by prefetchPages itself
+void
+testPrefetch (void)
+{
+    BM_PoolOptions options = {0};
+    PageNumber pages[10];
+    char expected[16];
+    
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing prefetch";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 20);
+    for (i = 0; i < 10; i++)
+        pages[i] = i;
+    
+    // without prefetch threads the pages are read before prefetchPages returns
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+    CHECK(prefetchPages(bm, pages, 3));
+    ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0]", bm, "prefetched pages are unpinned");
+    ASSERT_EQUALS_INT(3, getNumReadIO(bm), "check number of read I/Os");
+    CHECK(shutdownBufferPool(bm));
+    
+    // pins of pages in flight wait for the prefetch threads
+    options.prefetchThreads = 2;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 10, RS_LRU, NULL, &options));
+    CHECK(prefetchPages(bm, pages, 10));
+    for (i = 0; i < 10; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(expected, "%s-%i", "Page", i);
+        ASSERT_EQUALS_STRING(expected, h->data, "reading back prefetched page content");
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(10, getNumReadIO(bm), "check number of read I/Os");
+    
+    // resident pages are not read again
+    CHECK(prefetchPages(bm, pages, 10));
+    ASSERT_EQUALS_INT(10, getNumReadIO(bm), "check number of read I/Os after prefetching resident pages");
+    
+    // a shutdown refused because of a pinned page leaves the prefetch threads running
+    CHECK(pinPage(bm, h, 0));
+    ASSERT_ERROR(shutdownBufferPool(bm), "shut down a pool with a pinned page");
+    CHECK(unpinPage(bm, h));
+    for (i = 0; i < 10; i++)
+        pages[i] = i + 10;
+    CHECK(prefetchPages(bm, pages, 10));
+    for (i = 10; i < 20; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(expected, "%s-%i", "Page", i);
+        ASSERT_EQUALS_STRING(expected, h->data, "reading back pages prefetched after the refused shutdown");
+        CHECK(unpinPage(bm, h));
+    }
+    ASSERT_EQUALS_INT(20, getNumReadIO(bm), "check number of read I/Os");
+    CHECK(shutdownBufferPool(bm));
+    
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 10, RS_LRU, NULL, &options));
+    pages[0] = -1;
+    ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, prefetchPages(bm, pages, 1), "negative page number");
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test pinning several pages in one call
+void
+testPinPages (void)
+{
+    PageNumber pages[] = {4, 2, 1, 3, 2};
+    BM_PageHandle handles[5];
+    char expected[16];
+    
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing pinPages";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+    
+    // page 1 is a hit, page 2 is requested twice and only read once
+    CHECK(initBufferPool(bm, "testbuffer.bin", 5, RS_FIFO, NULL));
+    CHECK(pinPage(bm, h, 1));
+    CHECK(pinPages(bm, pages, handles, 5));
+    ASSERT_EQUALS_POOL("[1 2],[4 1],[2 2],[3 1],[-1 0]", bm, "check pool content after pinPages");
+    ASSERT_EQUALS_INT(4, getNumReadIO(bm), "check number of read I/Os");
+    for (i = 0; i < 5; i++)
+    {
+        sprintf(expected, "%s-%lld", "Page", pages[i]);
+        ASSERT_EQUALS_INT(pages[i], handles[i].pageNum, "check page number of the handle");
+        ASSERT_EQUALS_STRING(expected, handles[i].data, "reading back pinned page content");
+        CHECK(unpinPage(bm, &(handles[i])));
+    }
+    CHECK(unpinPage(bm, h));
+    
+    // if the misses do not fit, the pages pinned so far are unpinned again
+    pages[4] = 5;
+    CHECK(pinPage(bm, h, 0));
+    ASSERT_ERROR(pinPages(bm, pages, handles, 5), "try to pin more pages than there are frames");
+    ASSERT_EQUALS_POOL("[0 1],[4 0],[2 0],[3 0],[1 0]", bm, "check pool content after failed pinPages");
+    CHECK(unpinPage(bm, h));
+    
+    pages[0] = -1;
+    ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, pinPages(bm, pages, handles, 5), "negative page number");
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test that a page whose read fails is not left pinned or mapped, by pinPage and pinPages
+void
+testReadError (void)
+{
+    PageNumber pages[] = {1, 7, 2};
+    BM_PageHandle handles[3];
+    struct stat fileStat;
+    
+    RC result;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing read errors";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+    
+    // cut pages 5 to 9 off the file behind the pool's back, so reading them fails
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+    stat("testbuffer.bin", &fileStat);
+    ASSERT_TRUE(truncate("testbuffer.bin", fileStat.st_size - 5 * PAGE_SIZE) == 0, "truncate the page file");
+    
+    result = pinPage(bm, h, 7);
+    ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, result, "pin a page that can not be read");
+    ASSERT_EQUALS_POOL("[-1 0],[-1 0],[-1 0]", bm, "the failed page is neither mapped nor pinned");
+    
+    result = pinPages(bm, pages, handles, 3);
+    ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, result, "pin pages of which one can not be read");
+    ASSERT_EQUALS_POOL("[2 0],[1 0],[-1 0]", bm, "the pages that were read are unpinned again");
+    
+    // the frames are usable again
+    CHECK(pinPage(bm, h, 3));
+    ASSERT_EQUALS_STRING("Page-3", h->data, "reading back page content");
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_INT(5, getNumReadIO(bm), "check number of read I/Os");
+    
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test that the pages of a failed flush stay dirty, with and without flush threads and 
+// asynchronous I/O
+void
+testWriteError (void)
+{
+    BM_PoolOptions options[3] = {{0}, {0}, {0}};
+    struct rlimit limit;
+    struct rlimit oldLimit;
+    struct stat fileStat;
+    
+    int i, o;
+    RC result;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing write errors";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+    options[1].flushThreads = 2;
+    options[2].ioQueueDepth = 2;
+    
+    // writes past the header of the file fail (instead of raising SIGXFSZ)
+    stat("testbuffer.bin", &fileStat);
+    signal(SIGXFSZ, SIG_IGN);
+    getrlimit(RLIMIT_FSIZE, &oldLimit);
+    limit = oldLimit;
+    limit.rlim_cur = fileStat.st_size - 10 * PAGE_SIZE;
+    
+    for (o = 0; o < 3; o++)
+    {
+        CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 10, RS_FIFO, NULL, &(options[o])));
+        for (i = 0; i < 10; i++)
+        {
+            CHECK(pinPage(bm, h, i));
+            CHECK(markDirty(bm, h));
+            CHECK(unpinPage(bm, h));
+        }
+        
+        setrlimit(RLIMIT_FSIZE, &limit);
+        result = forceFlushPool(bm);
+        setrlimit(RLIMIT_FSIZE, &oldLimit);
+        ASSERT_EQUALS_INT(RC_WRITE_FAILED, result, "flush pages that can not be written");
+        ASSERT_EQUALS_POOL("[0x0],[1x0],[2x0],[3x0],[4x0],[5x0],[6x0],[7x0],[8x0],[9x0]", bm, "the pages that were not written stay dirty");
+        
+        CHECK(forceFlushPool(bm));
+        ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0],[4 0],[5 0],[6 0],[7 0],[8 0],[9 0]", bm, "all pages are written");
+        CHECK(shutdownBufferPool(bm));
+    }
+    
+    // forcing a page or evicting a dirty page fails and leaves it dirty in its frame
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+    for (i = 0; i < 3; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    setrlimit(RLIMIT_FSIZE, &limit);
+    result = forcePage(bm, h);
+    ASSERT_EQUALS_INT(RC_WRITE_FAILED, result, "force a page that can not be written");
+    result = pinPage(bm, h, 3);
+    ASSERT_EQUALS_INT(RC_WRITE_FAILED, result, "evict a page that can not be written");
+    setrlimit(RLIMIT_FSIZE, &oldLimit);
+    ASSERT_EQUALS_POOL("[0x0],[1x0],[2x0]", bm, "the pages that were not written stay dirty");
+    CHECK(pinPage(bm, h, 3));
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_POOL("[0x0],[3 0],[2x0]", bm, "the next page in FIFO order is evicted once it can be written");
+    CHECK(shutdownBufferPool(bm));
+    
+    // the background writer leaves a page it fails to write dirty, it wakes up when the first
+    // page is dirtied (once it waits) and then sleeps for a long interval
+    options[0].backgroundWriter = true;
+    options[0].writerIntervalMs = 100000;
+    options[0].dirtyHighWatermark = 10;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 10, RS_FIFO, NULL, &(options[0])));
+    usleep(10000);
+    setrlimit(RLIMIT_FSIZE, &limit);
+    CHECK(pinPage(bm, h, 0));
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    for (i = 0; i < 5000 && getNumWriteIO(bm) == 0; i++)
+        usleep(1000);
+    usleep(10000);
+    result = getNumWriteIO(bm);
+    ASSERT_EQUALS_POOL("[0x0],[-1 0],[-1 0],[-1 0],[-1 0],[-1 0],[-1 0],[-1 0],[-1 0],[-1 0]", bm, "the page the writer failed to write stays dirty");
+    setrlimit(RLIMIT_FSIZE, &oldLimit);
+    ASSERT_EQUALS_INT(1, result, "the writer tried to write the page");
+    CHECK(shutdownBufferPool(bm));
+    signal(SIGXFSZ, SIG_DFL);
+    
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test flushing with several I/O threads
+void
+testFlush (void)
+{
+    BM_PoolOptions options = {0};
+    char expected[16];
+    
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing forceFlushPool with flush threads";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 20);
+    
+    // dirty the pages in reverse order, they are written in file order by 3 threads
+    options.flushThreads = 3;
+    options.numPartitions = 2;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 10, RS_LRU, NULL, &options));
+    for (i = 9; i >= 0; i--)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "%s-%i", "Flushed", i);
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    
+    // a pinned page is not written
+    CHECK(pinPage(bm, h, 0));
+    CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(9, getNumWriteIO(bm), "check number of write I/Os");
+    CHECK(unpinPage(bm, h));
+    
+    // the shutdown writes the last dirty page
+    CHECK(shutdownBufferPool(bm));
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+    for (i = 0; i < 10; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(expected, "%s-%i", "Flushed", i);
+        ASSERT_EQUALS_STRING(expected, h->data, "reading back flushed page content");
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test the frame arena with every page size
+void
+testHugePages (void)
+{
+    BM_PoolOptions options = {0};
+    char expected[16];
+    
+    int i, hugePages;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle h[6];
+    testName = "Testing the frame arena";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 10);
+    
+    // the frames of all partitions and the scratch frames are page aligned and do not overlap
+    options.numPartitions = 2;
+    options.admissionSketchBytes = 64;
+    for (hugePages = HP_NONE; hugePages <= HP_EXPLICIT; hugePages++)
+    {
+        options.hugePages = hugePages;
+        CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 12, RS_LRU, NULL, &options));
+        for (i = 0; i < 6; i++)
+        {
+            CHECK(pinPage(bm, &(h[i]), i));
+            ASSERT_TRUE(((unsigned long)h[i].data % PAGE_SIZE) == 0, "frame data is page aligned");
+        }
+        for (i = 0; i < 6; i++)
+        {
+            sprintf(expected, "%s-%i", "Page", i);
+            ASSERT_EQUALS_STRING(expected, h[i].data, "reading back page content");
+            CHECK(unpinPage(bm, &(h[i])));
+        }
+        CHECK(shutdownBufferPool(bm));
+    }
+    
+    options.hugePages = HP_EXPLICIT + 1;
+    ASSERT_EQUALS_INT(RC_INVALID_STRATEGY_DATA, initBufferPoolWithOptions(bm, "testbuffer.bin", 6, RS_LRU, NULL, &options), "unknown huge page setting");
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    TEST_DONE();
+}
+
+// test the asynchronous storage interface with both engines, and a pool using it
+void
+testAsyncIO (void)
+{
+    BM_PoolOptions options = {0};
+    SM_FileHandle fh;
+    SM_AsyncIO aio;
+    SM_Completion completions[4];
+    SM_PageHandle pages[20];
+    char expected[16];
+    
+    int i, engine, done, numReaped;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle h[10];
+    PageNumber pageNums[10];
+    testName = "Testing asynchronous I/O";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    CHECK(ensureCapacity(20, &fh));
+    for (i = 0; i < 20; i++)
+        pages[i] = malloc(PAGE_SIZE);
+    
+    for (engine = SM_ASYNC_URING; engine <= SM_ASYNC_THREADS; engine++)
+    {
+        // write 20 pages in runs of 4 pages with at most 4 runs in flight
+        CHECK(initAsyncIO(&aio, &fh, 4, engine));
+        ASSERT_TRUE(engine == SM_ASYNC_URING || aio.engine == SM_ASYNC_THREADS, "the thread engine is used when asked for");
+        for (i = 0; i < 20; i++)
+            sprintf(pages[i], "%s-%i-%i", "Async", engine, i);
+        for (i = 0; i < 4; i++)
+            CHECK(submitWriteBlocks(&aio, i * 4, 4, pages + i * 4, pages[i * 4]));
+        ASSERT_ERROR(submitWriteBlocks(&aio, 16, 4, pages + 16, pages[16]), "submit to a full queue");
+        ASSERT_ERROR(submitReadBlocks(&aio, 18, 4, pages, NULL), "submit pages past the end of the file");
+        numReaped = reapBlocks(&aio, completions, 1, 4);
+        ASSERT_TRUE(numReaped >= 1 && completions[0].userData != NULL && completions[0].result == RC_OK, "reap a finished run");
+        CHECK(submitWriteBlocks(&aio, 16, 4, pages + 16, pages[16]));
+        for (done = numReaped; done < 5; done += numReaped)
+            numReaped = reapBlocks(&aio, completions, 5 - done, 4);
+        ASSERT_EQUALS_INT(0, aio.inFlight, "all runs reaped");
+        
+        // read them back in runs of 5 pages
+        for (i = 0; i < 20; i++)
+            memset(pages[i], 0, PAGE_SIZE);
+        for (i = 0; i < 4; i++)
+            CHECK(submitReadBlocks(&aio, i * 5, 5, pages + i * 5, NULL));
+        for (done = 0; done < 4; done += numReaped)
+        {
+            numReaped = reapBlocks(&aio, completions, 4 - done, 4);
+            for (i = 0; i < numReaped; i++)
+                CHECK(completions[i].result);
+        }
+        for (i = 0; i < 20; i++)
+        {
+            sprintf(expected, "%s-%i-%i", "Async", engine, i);
+            ASSERT_EQUALS_STRING(expected, pages[i], "reading back asynchronously written page");
+        }
+        CHECK(shutdownAsyncIO(&aio));
+    }
+    for (i = 0; i < 20; i++)
+        free(pages[i]);
+    CHECK(closePageFile(&fh));
+    
+    // a pool reads the misses of pinPages and flushes its pages with 2 runs in flight
+    options.ioQueueDepth = 2;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 10, RS_LRU, NULL, &options));
+    for (i = 0; i < 10; i++)
+        pageNums[i] = (i < 5) ? 2 * i : 30 + i;
+    CHECK(pinPages(bm, pageNums, h, 10));
+    ASSERT_EQUALS_INT(10, getNumReadIO(bm), "check number of read I/Os");
+    for (i = 0; i < 10; i++)
+    {
+        sprintf(h[i].data, "%s-%lld", "Flushed", pageNums[i]);
+        CHECK(markDirty(bm, &(h[i])));
+        CHECK(unpinPage(bm, &(h[i])));
+    }
+    CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(10, getNumWriteIO(bm), "check number of write I/Os");
+    CHECK(shutdownBufferPool(bm));
+    
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+    for (i = 0; i < 10; i++)
+    {
+        CHECK(pinPage(bm, &(h[0]), pageNums[i]));
+        sprintf(expected, "%s-%lld", "Flushed", pageNums[i]);
+        ASSERT_EQUALS_STRING(expected, h[0].data, "reading back flushed page content");
+        CHECK(unpinPage(bm, &(h[0])));
+    }
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    TEST_DONE();
+}
+
+// test a pool whose page file bypasses the kernel page cache
+void
+testDirectIO (void)
+{
+    BM_PoolOptions options = {0};
+    SM_FileHandle fh;
+    char expected[16];
+    
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    char *page = aligned_alloc(PAGE_SIZE, 2 * PAGE_SIZE);
+    testName = "Testing direct I/O";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    
+    // pages are written from the frames, and the file grows, without the page cache
+    options.directIO = true;
+    options.flushThreads = 2;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_CLOCK, NULL, &options));
+    for (i = 0; i < 12; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "%s-%i", "Direct", i);
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(12, getNumWriteIO(bm), "check number of write I/Os");
+    CHECK(shutdownBufferPool(bm));
+    
+    // a direct page file needs aligned buffers
+    CHECK(openPageFileWithFlags("testbuffer.bin", &fh, SM_OPEN_DIRECT));
+    ASSERT_EQUALS_INT(12, fh.totalNumPages, "the file grew to 12 pages");
+    for (i = 0; i < 12; i++)
+    {
+        CHECK(readBlock(i, &fh, page));
+        sprintf(expected, "%s-%i", "Direct", i);
+        ASSERT_EQUALS_STRING(expected, page, "reading back page written directly");
+    }
+    ASSERT_ERROR(readBlock(0, &fh, page + 1), "reading into an unaligned buffer");
+    CHECK(closePageFile(&fh));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(page);
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test a read-only pool that pins pages in place in a mapping of the page file
+void
+testMappedPool (void)
+{
+    BM_PoolOptions options = {0};
+    char expected[16];
+    
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle h[4];
+    PageNumber pageNums[] = {5, 6, 7};
+    testName = "Testing read-only mapped pool";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 100);
+    
+    // scan the file through 3 frames, every page points into the mapping
+    options.readOnlyMapping = true;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_LRU, NULL, &options));
+    CHECK(pinPage(bm, &(h[0]), 0));
+    for (i = 0; i < 100; i++)
+    {
+        CHECK(pinPage(bm, &(h[1]), i));
+        sprintf(expected, "%s-%i", "Page", i);
+        ASSERT_EQUALS_STRING(expected, h[1].data, "reading mapped page content");
+        ASSERT_TRUE(h[1].data == h[0].data + (long)i * PAGE_SIZE, "the page is pinned in place");
+        CHECK(unpinPage(bm, &(h[1])));
+    }
+    ASSERT_EQUALS_POOL("[0 1],[99 0],[98 0]", bm, "check pool content");
+    ASSERT_EQUALS_INT(100, getNumReadIO(bm), "check number of read I/Os");
+    
+    // pinPages maps the pages as well, nothing can be written and the file does not grow
+    ASSERT_EQUALS_INT(RC_WRITE_FAILED, pinPages(bm, pageNums, &(h[1]), 3), "pinPages with too few unpinned frames");
+    CHECK(pinPages(bm, pageNums, &(h[1]), 2));
+    ASSERT_TRUE(h[2].data == h[0].data + 6L * PAGE_SIZE, "pinPages pins in place");
+    ASSERT_ERROR(markDirty(bm, &(h[1])), "mark a mapped page dirty");
+    ASSERT_ERROR(forcePage(bm, &(h[1])), "force a mapped page");
+    ASSERT_ERROR(pinPage(bm, &(h[3]), 100), "pin a page past the end of the file");
+    CHECK(unpinPage(bm, &(h[0])));
+    CHECK(unpinPage(bm, &(h[1])));
+    CHECK(unpinPage(bm, &(h[2])));
+    ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    TEST_DONE();
+}
+
+// test that pages past the end of the file are added in one step and zeroed without a read
+void
+testPreallocation (void)
+{
+    BM_PoolOptions options = {0};
+    struct stat st;
+    
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    BM_PageHandle handles[4];
+    PageNumber pageNums[] = {1998, 1999, 2000, 2001};
+    testName = "Testing file extension with preallocation";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    
+    // the file jumps to 1001 pages, the pages it skips take no disk space
+    options.preallocatePages = 64;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_FIFO, NULL, &options));
+    CHECK(pinPage(bm, h, 1000));
+    for (i = 0; i < PAGE_SIZE; i++)
+    {
+        if (h->data[i] != '\0')
+            break;
+    }
+    ASSERT_EQUALS_INT(PAGE_SIZE, i, "the new page is zeroed");
+    sprintf(h->data, "%s-%lld", "Page", h->pageNum);
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(stat("testbuffer.bin", &st));
+    ASSERT_EQUALS_INT(1002 * PAGE_SIZE, (int)st.st_size, "the file grew to 1001 pages after its header");
+    ASSERT_TRUE(st.st_blocks * 512 < 1001L * PAGE_SIZE, "the skipped pages are sparse");
+    
+    // a run that straddles the end of the file reads only the pages the file already had
+    options.preallocatePages = 0;
+    options.ioQueueDepth = 2;
+    CHECK(shutdownBufferPool(bm));
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_FIFO, NULL, &options));
+    CHECK(pinPage(bm, h, 1999));
+    sprintf(h->data, "%s-%lld", "Page", h->pageNum);
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(forceFlushPool(bm));
+    CHECK(pinPages(bm, pageNums, handles, 4));
+    ASSERT_EQUALS_STRING("Page-1999", handles[1].data, "reading back the page below the old end");
+    ASSERT_TRUE(handles[2].data[0] == '\0' && handles[3].data[0] == '\0', "the pages past the old end are zeroed");
+    for (i = 0; i < 4; i++)
+        CHECK(unpinPage(bm, &(handles[i])));
+    ASSERT_EQUALS_INT(4, getNumReadIO(bm), "check number of read I/Os");
+    CHECK(shutdownBufferPool(bm));
+    
+    CHECK(initBufferPool(bm, "testbuffer.bin", 1, RS_FIFO, NULL));
+    CHECK(pinPage(bm, h, 1000));
+    ASSERT_EQUALS_STRING("Page-1000", h->data, "reading back the page written past the old end");
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test page numbers past the 32-bit range in a sparse file of several TB
+void
+testLargeFile (void)
+{
+    SM_FileHandle fh;
+    char expected[32];
+    
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle h[3];
+    PageNumber pageNums[] = {524288, (1LL << 31) - 1, (1LL << 31) + 5};
+    testName = "Testing page numbers beyond 2^31";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    
+    // the pages lie past 2 GB, 8 TB and on either side of the largest int
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+    for (i = 0; i < 3; i++)
+    {
+        CHECK(pinPage(bm, &(h[i]), pageNums[i]));
+        ASSERT_EQUALS_INT(pageNums[i], h[i].pageNum, "the handle keeps the 64-bit page number");
+        sprintf(h[i].data, "%s-%lld", "Page", pageNums[i]);
+        CHECK(markDirty(bm, &(h[i])));
+        CHECK(unpinPage(bm, &(h[i])));
+    }
+    ASSERT_EQUALS_POOL("[524288x0],[2147483647x0],[2147483653x0]", bm, "check pool content");
+    CHECK(shutdownBufferPool(bm));
+    
+    // the size of the file is not truncated to 32 bits
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    ASSERT_EQUALS_INT((1LL << 31) + 6, fh.totalNumPages, "the file holds 2^31 + 6 pages");
+    CHECK(closePageFile(&fh));
+    
+    CHECK(initBufferPool(bm, "testbuffer.bin", 1, RS_FIFO, NULL));
+    for (i = 0; i < 3; i++)
+    {
+        CHECK(pinPage(bm, &(h[0]), pageNums[i]));
+        sprintf(expected, "%s-%lld", "Page", pageNums[i]);
+        ASSERT_EQUALS_STRING(expected, h[0].data, "reading back a page past 2 GB");
+        CHECK(unpinPage(bm, &(h[0])));
+    }
+    ASSERT_EQUALS_INT(3, getNumReadIO(bm), "check number of read I/Os");
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    TEST_DONE();
+}
+
+// test page files with 64K pages, and a headerless file of 4K pages
+void
+testPageSize (void)
+{
+    BM_PoolOptions options = {0};
+    SM_FileHandle fh;
+    char expected[16];
+    
+    int i;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle h[4];
+    PageNumber pageNums[] = {4, 5, 6, 7};
+    char *page = aligned_alloc(PAGE_SIZE, 64 * 1024);
+    testName = "Testing page sizes per file";
+    
+    ASSERT_ERROR(createPageFileWithPageSize("testbuffer.bin", 3000), "create a file with a page size that is no power of two");
+    ASSERT_ERROR(createPageFileWithPageSize("testbuffer.bin", 2 * MAX_PAGE_SIZE), "create a file with too large pages");
+    CHECK(createPageFileWithPageSize("testbuffer.bin", 64 * 1024));
+    
+    // the frames take the page size of the file, whole pages are written and read directly
+    options.directIO = true;
+    options.ioQueueDepth = 2;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &options));
+    ASSERT_EQUALS_INT(64 * 1024, getPageSize(bm), "the frames have 64K pages");
+    for (i = 0; i < 4; i++)
+    {
+        CHECK(pinPage(bm, &(h[i]), i));
+        memset(h[i].data, 'a' + i, 64 * 1024);
+        sprintf(h[i].data, "%s-%i", "Page", i);
+        CHECK(markDirty(bm, &(h[i])));
+    }
+    for (i = 0; i < 4; i++)
+        CHECK(unpinPage(bm, &(h[i])));
+    CHECK(pinPages(bm, pageNums, h, 4));
+    for (i = 0; i < 4; i++)
+        CHECK(unpinPage(bm, &(h[i])));
+    CHECK(shutdownBufferPool(bm));
+    
+    // the header keeps the page size
+    CHECK(openPageFile("testbuffer.bin", &fh));
+    ASSERT_EQUALS_INT(64 * 1024, fh.pageSize, "the header records 64K pages");
+    ASSERT_EQUALS_INT(8, fh.totalNumPages, "the file holds 8 pages");
+    for (i = 0; i < 4; i++)
+    {
+        CHECK(readBlock(i, &fh, page));
+        sprintf(expected, "%s-%i", "Page", i);
+        ASSERT_EQUALS_STRING(expected, page, "reading back the start of a 64K page");
+        ASSERT_TRUE(page[64 * 1024 - 1] == 'a' + i, "reading back the end of a 64K page");
+    }
+    CHECK(closePageFile(&fh));
+    
+    // a mapped pool points 64K apart into the mapping
+    options.directIO = false;
+    options.ioQueueDepth = 0;
+    options.readOnlyMapping = true;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 2, RS_FIFO, NULL, &options));
+    CHECK(pinPage(bm, &(h[0]), 1));
+    CHECK(pinPage(bm, &(h[1]), 3));
+    ASSERT_EQUALS_STRING("Page-3", h[1].data, "reading a mapped 64K page");
+    ASSERT_TRUE(h[1].data == h[0].data + 2 * 64 * 1024, "the mapped pages are 64K apart");
+    CHECK(unpinPage(bm, &(h[0])));
+    CHECK(unpinPage(bm, &(h[1])));
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    // a file without a header holds PAGE_SIZE pages
+    FILE *file = fopen("testbuffer.bin", "w");
+    memset(page, 0, 2 * PAGE_SIZE);
+    strcpy(page + PAGE_SIZE, "Page-1");
+    fwrite(page, 1, 2 * PAGE_SIZE, file);
+    fclose(file);
+    CHECK(initBufferPool(bm, "testbuffer.bin", 1, RS_FIFO, NULL));
+    ASSERT_EQUALS_INT(PAGE_SIZE, getPageSize(bm), "a headerless file has the default page size");
+    CHECK(pinPage(bm, &(h[0]), 1));
+    ASSERT_EQUALS_STRING("Page-1", h[0].data, "reading a page of a headerless file");
+    CHECK(unpinPage(bm, &(h[0])));
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(page);
+    free(bm);
+    TEST_DONE();
+}
+
+// test one pool serving pages of several files under a single replacement policy
+void
+testMultiFile (void)
+{
+    BM_PoolOptions options = {0};
+    pthread_t flusher;
+    
+    int i;
+    RC result;
+    int fileId, sameId, otherId;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing a pool shared by several page files";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    CHECK(createPageFile("testbuffer2.bin"));
+    CHECK(createPageFileWithPageSize("testbuffer3.bin", 64 * 1024));
+    
+    // a file registered twice keeps its id, a file with other page sizes is rejected
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+    CHECK(registerPageFile(bm, "testbuffer2.bin", &fileId));
+    ASSERT_EQUALS_INT(1, fileId, "the first registered file gets id 1");
+    CHECK(registerPageFile(bm, "testbuffer2.bin", &sameId));
+    ASSERT_EQUALS_INT(fileId, sameId, "registering the file again gives the same id");
+    ASSERT_ERROR(registerPageFile(bm, "testbuffer3.bin", &otherId), "register a file with 64K pages");
+    ASSERT_ERROR(unregisterPageFile(bm, 0), "unregister the pool's own file");
+    CHECK(registerPageFile(bm, "testbuffer.bin", &otherId));
+    ASSERT_EQUALS_INT(0, otherId, "registering the pool's own file gives id 0");
+    CHECK(unregisterPageFile(bm, 0));
+    ASSERT_ERROR(unregisterPageFile(bm, 0), "unregister the pool's own file again");
+    
+    // page 0 of both files are different pages
+    CHECK(pinPage(bm, h, 0));
+    sprintf(h->data, "%s-%lld", "Page", h->pageNum);
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, MAKE_FILE_PAGE(fileId, 0)));
+    ASSERT_EQUALS_INT(MAKE_FILE_PAGE(fileId, 0), h->pageNum, "the handle keeps the file id");
+    sprintf(h->data, "%s-%lld", "File", PAGE_IN_FILE(h->pageNum));
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, MAKE_FILE_PAGE(fileId, 1)));
+    sprintf(h->data, "%s-%lld", "File", PAGE_IN_FILE(h->pageNum));
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    
+    // flushing the file writes only its own pages
+    CHECK(forceFlushFile(bm, fileId));
+    ASSERT_EQUALS_INT(2, getNumWriteIO(bm), "only the pages of the file are written");
+    CHECK(forceFlushPool(bm));
+    ASSERT_EQUALS_INT(3, getNumWriteIO(bm), "the pool flush writes the rest");
+    
+    // the files share the frames, the next page evicts the least recently used of any file
+    CHECK(pinPage(bm, h, MAKE_FILE_PAGE(fileId, 1)));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, MAKE_FILE_PAGE(fileId, 0)));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, MAKE_FILE_PAGE(fileId, 2)));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, MAKE_FILE_PAGE(fileId, 0)));
+    ASSERT_EQUALS_STRING("File-0", h->data, "the page of the file is still cached");
+    ASSERT_EQUALS_INT(4, getNumReadIO(bm), "check number of read I/Os");
+    
+    // the last registration cannot go while a page of the file is pinned
+    CHECK(unregisterPageFile(bm, fileId));
+    ASSERT_ERROR(unregisterPageFile(bm, fileId), "unregister a file with a pinned page");
+    CHECK(unpinPage(bm, h));
+    CHECK(unregisterPageFile(bm, fileId));
+    ASSERT_ERROR(pinPage(bm, h, MAKE_FILE_PAGE(fileId, 0)), "pin a page of an unregistered file");
+    ASSERT_ERROR(forceFlushFile(bm, fileId), "flush an unregistered file");
+    CHECK(pinPage(bm, h, 0));
+    ASSERT_EQUALS_STRING("Page-0", h->data, "reading back the page of the pool's own file");
+    ASSERT_EQUALS_INT(5, getNumReadIO(bm), "the page was evicted by the other file");
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+    
+    // the pages were written to their own file
+    CHECK(initBufferPool(bm, "testbuffer2.bin", 2, RS_FIFO, NULL));
+    CHECK(pinPage(bm, h, 1));
+    ASSERT_EQUALS_STRING("File-1", h->data, "reading back a page of the registered file");
+    CHECK(unpinPage(bm, h));
+    CHECK(shutdownBufferPool(bm));
+    
+    // flushing the file leaves the pages of the other files where they are in the LRU order
+    CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+    CHECK(registerPageFile(bm, "testbuffer2.bin", &fileId));
+    CHECK(pinPage(bm, h, 0));
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, MAKE_FILE_PAGE(fileId, 0)));
+    CHECK(markDirty(bm, h));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, MAKE_FILE_PAGE(fileId, 1)));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, MAKE_FILE_PAGE(fileId, 0)));
+    CHECK(unpinPage(bm, h));
+    CHECK(forceFlushFile(bm, fileId));
+    CHECK(pinPage(bm, h, MAKE_FILE_PAGE(fileId, 2)));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, MAKE_FILE_PAGE(fileId, 1)));
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_INT(4, getNumReadIO(bm), "the page of the pool's own file was evicted");
+    CHECK(shutdownBufferPool(bm));
+    
+    // a concurrent pool closes a file only once the writes and flushes of other threads are 
+    // done with it
+    options.concurrent = true;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &options));
+    concurrentPool = bm;
+    concurrentErrors = 0;
+    concurrentStop = 0;
+    pthread_create(&flusher, NULL, fileFlusher, NULL);
+    for (i = 0; i < 100; i++)
+    {
+        CHECK(registerPageFile(bm, "testbuffer2.bin", &fileId));
+        CHECK(pinPage(bm, h, MAKE_FILE_PAGE(fileId, i % 5)));
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+        
+        // a flush or eviction of the other thread may pin the page for a moment
+        while ((result = unregisterPageFile(bm, fileId)) == RC_WRITE_FAILED);
+        CHECK(result);
+    }
+    __atomic_store_n(&concurrentStop, 1, __ATOMIC_RELAXED);
+    pthread_join(flusher, NULL);
+    ASSERT_EQUALS_INT(0, concurrentErrors, "check pages dirtied and flushed by the other thread");
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    CHECK(destroyPageFile("testbuffer2.bin"));
+    CHECK(destroyPageFile("testbuffer3.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
+
+// test growing and shrinking a pool while it keeps its cached pages
+void
+testResize (void)
+{
+    BM_PoolOptions options = {0};
+    ReplacementStrategy strategies[] = {RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC};
+    char expected[16];
+    pthread_t unpinner;
+    
+    int i, s;
+    int numResident = 0;
+    BM_BufferPool *bm = MAKE_POOL();
+    BM_PageHandle *h = MAKE_PAGE_HANDLE();
+    testName = "Testing online pool resize";
+    
+    CHECK(createPageFile("testbuffer.bin"));
+    createDummyPages(bm, 20);
+    
+    // the pool cannot start with more frames than it reserved
+    options.maxPages = 2;
+    ASSERT_EQUALS_INT(RC_INVALID_STRATEGY_DATA, initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, &options), "more frames than maxPages");
+    
+    options.maxPages = 6;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, &options));
+    for (i = 0; i < 3; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        sprintf(h->data, "%s-%i", "Dirty", i);
+        CHECK(markDirty(bm, h));
+        CHECK(unpinPage(bm, h));
+    }
+    
+    // growing keeps the cached pages and fills the new frames first
+    CHECK(resizeBufferPool(bm, 5));
+    ASSERT_EQUALS_POOL("[0x0],[1x0],[2x0],[-1 0],[-1 0]", bm, "the new frames are empty");
+    CHECK(pinPage(bm, h, 3));
+    CHECK(unpinPage(bm, h));
+    CHECK(pinPage(bm, h, 4));
+    ASSERT_EQUALS_POOL("[0x0],[1x0],[2x0],[3 0],[4 1]", bm, "no page was evicted");
+    ASSERT_ERROR(resizeBufferPool(bm, 7), "grow past maxPages");
+    ASSERT_ERROR(resizeBufferPool(bm, 0), "shrink to no frames");
+    
+    // shrinking writes and evicts the pages of the released frames, which must be unpinned
+    ASSERT_ERROR(resizeBufferPool(bm, 2), "shrink while a released frame is pinned");
+    ASSERT_EQUALS_POOL("[0x0],[1x0],[2x0],[3 0],[4 1]", bm, "a failed shrink keeps the pool");
+    CHECK(unpinPage(bm, h));
+    CHECK(resizeBufferPool(bm, 2));
+    ASSERT_EQUALS_POOL("[0x0],[1x0]", bm, "the frames past the new size are released");
+    ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "the dirty page of a released frame was written");
+    CHECK(pinPage(bm, h, 2));
+    ASSERT_EQUALS_STRING("Dirty-2", h->data, "reading back the written page");
+    CHECK(unpinPage(bm, h));
+    ASSERT_EQUALS_POOL("[2 0],[1x0]", bm, "the pool evicts within the frames that are left");
+    CHECK(shutdownBufferPool(bm));
+    
+    // every strategy keeps working while frames come and go
+    for (s = 0; s < 6; s++)
+    {
+        CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, strategies[s], NULL, &options));
+        for (i = 0; i < 4; i++)
+        {
+            CHECK(pinPage(bm, h, i));
+            CHECK(unpinPage(bm, h));
+        }
+        CHECK(resizeBufferPool(bm, 6));
+        for (i = 0; i < 12; i++)
+        {
+            CHECK(pinPage(bm, h, i % 6));
+            CHECK(unpinPage(bm, h));
+        }
+        ASSERT_EQUALS_INT(6, getNumReadIO(bm), "the pool grew without evicting");
+        CHECK(resizeBufferPool(bm, 2));
+        for (i = 0; i < 20; i++)
+        {
+            CHECK(pinPage(bm, h, i));
+            sprintf(expected, "%s-%i", (i < 3) ? "Dirty" : "Page", i);
+            ASSERT_EQUALS_STRING(expected, h->data, "reading pages through the shrunk pool");
+            CHECK(unpinPage(bm, h));
+        }
+        CHECK(resizeBufferPool(bm, 5));
+        for (i = 19; i >= 0; i--)
+        {
+            CHECK(pinPage(bm, h, i));
+            sprintf(expected, "%s-%i", (i < 3) ? "Dirty" : "Page", i);
+            ASSERT_EQUALS_STRING(expected, h->data, "reading pages through the grown pool");
+            CHECK(unpinPage(bm, h));
+        }
+        CHECK(shutdownBufferPool(bm));
+    }
+    
+    // a partitioned pool spreads the frames over its partitions
+    options.numPartitions = 2;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 2, RS_LRU, NULL, &options));
+    CHECK(resizeBufferPool(bm, 6));
+    for (i = 0; i < 20; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        CHECK(unpinPage(bm, h));
+    }
+    PageNumber *frameContents = getFrameContents(bm);
+    for (i = 0; i < 6; i++)
+    {
+        if (frameContents[i] != NO_PAGE)
+            numResident++;
+    }
+    free(frameContents);
+    ASSERT_EQUALS_INT(6, numResident, "the partitions use all of their frames");
+    ASSERT_ERROR(resizeBufferPool(bm, 1), "shrink below one frame per partition");
+    CHECK(resizeBufferPool(bm, 2));
+    ASSERT_EQUALS_INT(2, bm->numPages, "the partitions were shrunk");
+    CHECK(shutdownBufferPool(bm));
+    
+    // a concurrent pool waits for a released frame to be unpinned by another thread
+    options.numPartitions = 0;
+    options.concurrent = true;
+    CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_FIFO, NULL, &options));
+    for (i = 0; i < 4; i++)
+    {
+        CHECK(pinPage(bm, h, i));
+        if (i < 3)
+            CHECK(unpinPage(bm, h));
+    }
+    concurrentPool = bm;
+    pthread_create(&unpinner, NULL, delayedUnpin, h);
+    CHECK(resizeBufferPool(bm, 2));
+    pthread_join(unpinner, NULL);
+    ASSERT_EQUALS_POOL("[0 0],[1 0]", bm, "the shrink waited for the pin to be dropped");
+    CHECK(shutdownBufferPool(bm));
+    CHECK(destroyPageFile("testbuffer.bin"));
+    
+    free(bm);
+    free(h);
+    TEST_DONE();
+}
 
 // test error cases
 void
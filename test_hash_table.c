@@ -1,5 +1,39 @@
 #include "hash_table.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdbool.h>
+
+// random operations checked against a plain array, and the size of the lookup benchmark
+#define NUM_OPERATIONS 200000
+#define MAX_KEY 4096
+#define NUM_KEYS 100000
+#define NUM_LOOKUPS 4000000
+
+// a concurrent table holds STABLE_KEYS keys that are never removed and MOVING_KEYS keys that
+// the writer keeps removing and inserting again, a key's value is always twice the key
+#define STABLE_KEYS 200
+#define MOVING_KEYS 56
+#define NUM_MOVES 200000
+
+// set by the writer once it is done
+bool writerDone = false;
+
+// remove and insert moving keys, so pairs keep shifting between slots under the reader
+void *
+moveKeys (void *arg)
+{
+    HT_TableHandle *ht = (HT_TableHandle *)arg;
+    for (int i = 0; i < NUM_MOVES; i++)
+    {
+        int key = STABLE_KEYS + i % (2 * MOVING_KEYS);
+        if (removePair(ht, key) == 1)
+            setValue(ht, key, key * 2);
+    }
+    __atomic_store_n(&writerDone, true, __ATOMIC_RELEASE);
+    return NULL;
+}
 
 // main method
 void
@@ -52,4 +86,82 @@ main (void)
     }
     printf("removePair & getValue succeeded\n*** freeing table ***\n");
     freeHashTable(&ht);
+
+    // mix inserts, updates and removals of a small key range, so removals keep moving pairs
+    // back into freed slots
+    int *expected = malloc(sizeof(int) * MAX_KEY);
+    for (int i = 0; i < MAX_KEY; i++)
+        expected[i] = -1;
+    initHashTable(&ht, 16);
+    srand(42);
+    for (int i = 0; i < NUM_OPERATIONS; i++)
+    {
+        int key = rand() % MAX_KEY;
+        int v;
+        if (rand() % 3 == 0)
+        {
+            if (removePair(&ht, key) != (expected[key] < 0))
+            {
+                printf("removePair failed\n");
+                return;
+            }
+            expected[key] = -1;
+        }
+        else
+        {
+            setValue(&ht, key, i);
+            expected[key] = i;
+        }
+        key = rand() % MAX_KEY;
+        if (getValue(&ht, key, &v) != (expected[key] < 0) || (expected[key] >= 0 && v != expected[key]))
+        {
+            printf("random getValue failed\n");
+            return;
+        }
+    }
+    printf("random operations succeeded\n");
+    freeHashTable(&ht);
+    free(expected);
+
+    // look up random keys of a table sized for a pool of NUM_KEYS frames
+    initHashTable(&ht, NUM_KEYS);
+    for (int i = 0; i < NUM_KEYS; i++)
+        setValue(&ht, i, i);
+    long found = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < NUM_LOOKUPS; i++)
+    {
+        int v;
+        if (getValue(&ht, (int)(((unsigned int)i * 2654435761u) % (2 * NUM_KEYS)), &v) == 0)
+            found++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("%i lookups (%li hits) in a table of %i keys: %.1f ns/lookup\n", NUM_LOOKUPS, found, NUM_KEYS, elapsed / NUM_LOOKUPS);
+    freeHashTable(&ht);
+
+    // look keys up without locks while another thread changes the table
+    initConcurrentHashTable(&ht, STABLE_KEYS + MOVING_KEYS);
+    for (int i = 0; i < STABLE_KEYS; i++)
+        setValue(&ht, i, i * 2);
+    bool readFailed = false;
+    pthread_t writer;
+    pthread_create(&writer, NULL, moveKeys, &ht);
+    for (int i = 0; !__atomic_load_n(&writerDone, __ATOMIC_ACQUIRE); i++)
+    {
+        int key = i % (STABLE_KEYS + 2 * MOVING_KEYS);
+        int v;
+        int rc = getValue(&ht, key, &v);
+        if ((key < STABLE_KEYS && rc == 1) || (rc == 0 && v != key * 2))
+            readFailed = true;
+    }
+    pthread_join(writer, NULL);
+    if (readFailed)
+    {
+        printf("concurrent getValue failed\n");
+        return;
+    }
+    printf("concurrent getValue succeeded\n");
+    freeHashTable(&ht);
 }
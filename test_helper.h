@@ -36,15 +36,15 @@ extern char *testName;
 			printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, expected, real, message); \
 		} while(0)
 
-// check whether two ints are equals
+// check whether two ints (of any width) are equals
 #define ASSERT_EQUALS_INT(expected,real,message)			\
 		do {									\
 			if ((expected) != (real))					\
 			{									\
-				printf("[%s-%s-L%i-%s] FAILED: expected <%i> but was <%i>: %s\n",TEST_INFO, expected, real, message); \
+				printf("[%s-%s-L%i-%s] FAILED: expected <%lld> but was <%lld>: %s\n",TEST_INFO, (long long)(expected), (long long)(real), message); \
 				exit(1);							\
 			}									\
-			printf("[%s-%s-L%i-%s] OK: expected <%i> and was <%i>: %s\n",TEST_INFO, expected, real, message); \
+			printf("[%s-%s-L%i-%s] OK: expected <%lld> and was <%lld>: %s\n",TEST_INFO, (long long)(expected), (long long)(real), message); \
 		} while(0)
 
 // check whether two ints are equals